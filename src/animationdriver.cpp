@@ -0,0 +1,33 @@
+// animationdriver.cpp
+#include "animationdriver.h"
+#include <QScreen>
+#include <QWidget>
+#include <QtMath>
+
+static int s_frameCap = 60;
+
+AnimationDriver::AnimationDriver(QWidget *widget)
+    : QObject(widget), m_widget(widget)
+{
+    m_timer.setTimerType(Qt::PreciseTimer);
+    connect(&m_timer, &QTimer::timeout, this, &AnimationDriver::frame);
+}
+
+void AnimationDriver::setFrameCap(int fps) {
+    s_frameCap = qBound(1, fps, 1000);
+}
+
+int AnimationDriver::frameCap() {
+    return s_frameCap;
+}
+
+void AnimationDriver::start() {
+    if (m_timer.isActive()) return;
+
+    // the window may have moved to another screen since last time
+    qreal refresh = m_widget->screen() ? m_widget->screen()->refreshRate() : 60.0;
+    if (refresh <= 0) refresh = 60.0;
+    const qreal fps = qMin<qreal>(refresh, s_frameCap);
+
+    m_timer.start(qMax(1, qRound(1000.0 / fps)));
+}
@@ -0,0 +1,33 @@
+// animationdriver.h
+#pragma once
+#include <QObject>
+#include <QTimer>
+
+class QWidget;
+
+// Length of the white flash after a click
+const int CLICK_FLASH_MS = 150;
+
+// Frame clock for the hover pulse and click flash. Ticks at the refresh rate
+// of the widget's screen, capped at frameCap(), and only while started:
+// the owner stops it as soon as nothing animates, so an idle grid costs nothing.
+class AnimationDriver : public QObject {
+    Q_OBJECT
+public:
+    explicit AnimationDriver(QWidget *widget);
+
+    // Upper bound on animation fps for all drivers, from the settings
+    static void setFrameCap(int fps);
+    static int frameCap();
+
+    void start();   // no-op while running
+    void stop() { m_timer.stop(); }
+    bool isRunning() const { return m_timer.isActive(); }
+
+signals:
+    void frame();
+
+private:
+    QWidget *m_widget;
+    QTimer m_timer;
+};
@@ -1,13 +1,13 @@
 #pragma once
 #include <QString>
 #include <QPixmap>
+#include <QSize>
 
+// One grid entry as handed around between scanner, updater and ThumbnailModel
 struct CachedImage {
     QPixmap pix;
     QString folder;
     QString filePath;
-
-    bool operator==(const CachedImage &other) const {
-        return filePath == other.filePath;
-    }
+    QSize size; // thumbnail size, known before the pixmap is decoded
+    qint64 mtime = 0;   // wallpaper mtime, 0 if unknown
 };
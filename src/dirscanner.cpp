@@ -0,0 +1,321 @@
+// dirscanner.cpp
+#include "dirscanner.h"
+#include <QFile>
+#include <QHash>
+#include <QSet>
+#include <QThread>
+#include <QThreadPool>
+#include <QDebug>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// What getdents64 hands back, glibc doesn't declare it
+struct LinuxDirent64 {
+    quint64 d_ino;
+    qint64 d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+static const char *IMAGE_EXTENSIONS[] = {
+    "png", "jpg", "jpeg", "jpe", "webp", "bmp", "gif", "tif", "tiff", "jxl", "avif",
+};
+
+static bool isImageBytes(const char *name, size_t len) {
+    const char *dot = static_cast<const char *>(memrchr(name, '.', len));
+    if (!dot) return false;
+    const size_t extLen = len - size_t(dot + 1 - name);
+    for (const char *ext : IMAGE_EXTENSIONS) {
+        if (std::strlen(ext) == extLen && strncasecmp(dot + 1, ext, extLen) == 0) return true;
+    }
+    return false;
+}
+
+bool DirScanner::isImageName(QStringView name) {
+    const QByteArray bytes = name.toUtf8();
+    return isImageBytes(bytes.constData(), size_t(bytes.size()));
+}
+
+bool DirScanner::listNames(const QString &dir, const std::function<void(const char *, size_t)> &fn) {
+    const int fd = ::open(QFile::encodeName(dir).constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    std::vector<char> buffer(64 * 1024);
+    for (;;) {
+        const long n = ::syscall(SYS_getdents64, fd, buffer.data(), buffer.size());
+        if (n <= 0) break;
+        for (long off = 0; off < n;) {
+            const auto *d = reinterpret_cast<const LinuxDirent64 *>(buffer.data() + off);
+            off += d->d_reclen;
+            if (d->d_name[0] != '.') fn(d->d_name, std::strlen(d->d_name));
+        }
+    }
+    ::close(fd);
+    return true;
+}
+
+static qint64 nanos(const struct statx_timestamp &t) {
+    return qint64(t.tv_sec) * 1000000000LL + t.tv_nsec;
+}
+
+bool DirScanner::statFiles(const QString &dir, QList<ScannedFile> &files) {
+    const int fd = ::open(QFile::encodeName(dir).constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    for (int i = 0; i < files.size();) {
+        struct statx stx;
+        if (::statx(fd, QFile::encodeName(files[i].name).constData(), AT_STATX_DONT_SYNC,
+                    STATX_MTIME | STATX_SIZE, &stx) != 0) {
+            files.removeAt(i);
+            continue;
+        }
+        files[i].mtime = nanos(stx.stx_mtime);
+        files[i].size = qint64(stx.stx_size);
+        ++i;
+    }
+    ::close(fd);
+    return true;
+}
+
+DirScanner::DirScanner(int threads)
+    : m_threads(threads > 0 ? threads : qBound(1, QThread::idealThreadCount(), 8))
+{
+}
+
+namespace {
+
+// One worker's directories, the owner pops the back, thieves take the front
+struct TaskQueue {
+    std::mutex mutex;
+    std::deque<std::string> paths;
+};
+
+struct ScanState {
+    const DirScanner::ReuseFn *reuse = nullptr;
+    std::vector<TaskQueue> queues;
+    std::atomic<int> pending{0};    // queued + being listed, 0 = done
+    std::atomic<int> queued{0};     // waiting in some queue, idle workers sleep while it's 0
+    std::mutex idleMutex;
+    std::condition_variable idle;   // woken on push and once pending drops to 0
+    std::atomic<int> listed{0};
+    std::atomic<int> stats{0};
+
+    std::mutex resultMutex;
+    QList<ScannedDir> results;
+    QSet<QPair<quint64, quint64>> seen;  // dev, inode, symlinked folders are walked once
+
+    explicit ScanState(int n) : queues(n) {}
+
+    void push(int worker, std::string path) {
+        pending.fetch_add(1);
+        {
+            std::lock_guard<std::mutex> lock(queues[worker].mutex);
+            queues[worker].paths.push_back(std::move(path));
+        }
+        queued.fetch_add(1);
+        wake(false);
+    }
+
+    void finished() {
+        if (pending.fetch_sub(1) == 1) wake(true);
+    }
+
+    void wake(bool all) {
+        // taking the lock orders this with a worker between its check and its wait
+        std::lock_guard<std::mutex> lock(idleMutex);
+        if (all) idle.notify_all();
+        else idle.notify_one();
+    }
+
+    // false once everything is done
+    bool waitForWork() {
+        std::unique_lock<std::mutex> lock(idleMutex);
+        idle.wait(lock, [this]{ return queued.load() > 0 || pending.load() == 0; });
+        return pending.load() > 0;
+    }
+
+    bool take(int worker, std::string &path) {
+        {
+            TaskQueue &own = queues[worker];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.paths.empty()) {
+                path = std::move(own.paths.back());
+                own.paths.pop_back();
+                queued.fetch_sub(1);
+                return true;
+            }
+        }
+        for (size_t i = 1; i < queues.size(); ++i) {
+            TaskQueue &victim = queues[(worker + i) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.paths.empty()) {
+                path = std::move(victim.paths.front());
+                victim.paths.pop_front();
+                queued.fetch_sub(1);
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+void listDirectory(ScanState &state, int worker, const std::string &path,
+                   std::vector<char> &buffer, std::string &childPath) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) return;
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(state.resultMutex);
+        const QPair<quint64, quint64> id(quint64(st.st_dev), quint64(st.st_ino));
+        if (state.seen.contains(id)) {
+            ::close(fd);
+            return;
+        }
+        state.seen.insert(id);
+    }
+
+    ScannedDir dir;
+    dir.path = QFile::decodeName(QByteArray::fromRawData(path.data(), int(path.size())));
+    dir.mtime = qint64(st.st_mtim.tv_sec) * 1000000000LL + st.st_mtim.tv_nsec;
+
+    if (*state.reuse && (*state.reuse)(dir.path, dir.mtime, dir.subdirs)) {
+        ::close(fd);
+        for (const QString &sub : std::as_const(dir.subdirs)) state.push(worker, QFile::encodeName(sub).toStdString());
+        std::lock_guard<std::mutex> lock(state.resultMutex);
+        state.results.append(std::move(dir));
+        return;
+    }
+    dir.listed = true;
+    state.listed.fetch_add(1);
+
+    // names only first, stat'ing happens in one go once the listing is done
+    std::vector<std::pair<std::string, unsigned char>> candidates;
+    for (;;) {
+        const long n = ::syscall(SYS_getdents64, fd, buffer.data(), buffer.size());
+        if (n <= 0) break;
+        for (long off = 0; off < n;) {
+            const auto *d = reinterpret_cast<const LinuxDirent64 *>(buffer.data() + off);
+            off += d->d_reclen;
+
+            if (d->d_name[0] == '.') continue; // ., .. and hidden entries, like QDir's default
+            const size_t len = std::strlen(d->d_name);
+            if (d->d_type == DT_DIR || d->d_type == DT_LNK || d->d_type == DT_UNKNOWN ||
+                (d->d_type == DT_REG && isImageBytes(d->d_name, len)))
+                candidates.emplace_back(std::string(d->d_name, len), d->d_type);
+        }
+    }
+
+    QStringList subdirs;
+    for (const auto &c : candidates) {
+        bool isDir = c.second == DT_DIR;
+        bool isFile = c.second == DT_REG;
+        struct statx stx;
+
+        if (!isDir) {
+            // symlinks and filesystems without d_type need the real type as well
+            const unsigned mask = STATX_MTIME | STATX_SIZE | (isFile ? 0 : STATX_TYPE);
+            state.stats.fetch_add(1, std::memory_order_relaxed);
+            if (::statx(fd, c.first.c_str(), AT_STATX_DONT_SYNC, mask, &stx) != 0) continue;
+            if (!isFile) {
+                isDir = S_ISDIR(stx.stx_mode);
+                isFile = S_ISREG(stx.stx_mode) && isImageBytes(c.first.data(), c.first.size());
+            }
+        }
+
+        if (isDir) {
+            childPath.assign(path);
+            childPath += '/';
+            childPath += c.first;
+            subdirs.append(QFile::decodeName(QByteArray::fromStdString(childPath)));
+            state.push(worker, childPath);
+        } else if (isFile) {
+            ScannedFile f;
+            f.name = QFile::decodeName(QByteArray::fromStdString(c.first));
+            f.mtime = nanos(stx.stx_mtime);
+            f.size = qint64(stx.stx_size);
+            dir.files.append(f);
+        }
+    }
+    ::close(fd);
+
+    // same order libraryOrderLess() uses
+    std::sort(dir.files.begin(), dir.files.end(), [](const ScannedFile &a, const ScannedFile &b) {
+        return a.name < b.name;
+    });
+    std::sort(subdirs.begin(), subdirs.end());
+    dir.subdirs = subdirs;
+
+    std::lock_guard<std::mutex> lock(state.resultMutex);
+    state.results.append(std::move(dir));
+}
+
+} // namespace
+
+QList<ScannedDir> DirScanner::scan(const QString &root, const ReuseFn &reuse) {
+    ScanState state(m_threads);
+    state.reuse = &reuse;
+    state.push(0, QFile::encodeName(root).toStdString());
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(m_threads);
+    for (int w = 0; w < m_threads; ++w) {
+        pool.start([&state, w](){
+            std::vector<char> buffer(64 * 1024);
+            std::string path, childPath;
+            for (;;) {
+                if (!state.take(w, path)) {
+                    // everything left is being listed elsewhere, sleep until it pushes more
+                    if (!state.waitForWork()) break;
+                    continue;
+                }
+                listDirectory(state, w, path, buffer, childPath);
+                state.finished();
+            }
+        });
+    }
+    pool.waitForDone();
+
+    m_listedDirs = state.listed;
+    m_statCalls = state.stats;
+
+    // workers finish in any order, put them back into library order
+    QHash<QString, int> byPath;
+    byPath.reserve(state.results.size());
+    for (int i = 0; i < state.results.size(); ++i) byPath.insert(state.results[i].path, i);
+
+    QList<ScannedDir> ordered;
+    ordered.reserve(state.results.size());
+    QList<QPair<QString, int>> stack;
+    stack.append({root, -1});
+    while (!stack.isEmpty()) {
+        const QPair<QString, int> item = stack.takeLast();
+        const int at = byPath.value(item.first, -1);
+        if (at < 0) continue; // vanished or unreadable
+
+        ScannedDir dir = std::move(state.results[at]);
+        dir.parent = item.second;
+        const int self = ordered.size();
+        for (int i = dir.subdirs.size() - 1; i >= 0; --i) stack.append({dir.subdirs[i], self});
+        ordered.append(std::move(dir));
+    }
+    return ordered;
+}
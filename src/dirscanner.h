@@ -0,0 +1,58 @@
+// dirscanner.h
+#pragma once
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <functional>
+
+struct ScannedFile {
+    QString name;
+    qint64 mtime = 0;       // nanoseconds
+    qint64 size = 0;
+};
+
+struct ScannedDir {
+    QString path;
+    qint64 mtime = 0;       // nanoseconds
+    int parent = -1;        // index into the scan result
+    bool listed = false;    // false when reuse() vouched for it, files is empty then
+    QList<ScannedFile> files;   // images only, sorted by name
+    QStringList subdirs;        // full paths, sorted
+};
+
+// Walks a wallpaper tree with openat/getdents64 instead of QDirIterator.
+// d_type decides files vs folders, anything that isn't an image by name is
+// dropped before it's ever stat'ed, and only the images left get a statx.
+// Every directory is a task: workers pop their own newest one and steal the
+// oldest from a neighbour when they run dry, so one huge subtree doesn't
+// leave the other threads idle.
+class DirScanner {
+public:
+    // Asked (on a worker thread) before listing a directory. Returning true
+    // skips the listing, the subdirs filled in are still walked.
+    using ReuseFn = std::function<bool(const QString &path, qint64 mtime, QStringList &subdirs)>;
+
+    explicit DirScanner(int threads = 0);
+
+    // Directories in library order: depth-first, subfolders by name
+    QList<ScannedDir> scan(const QString &root, const ReuseFn &reuse = ReuseFn());
+
+    // Stats of the last scan
+    int listedDirs() const { return m_listedDirs; }
+    int statCalls() const { return m_statCalls; }
+
+    static bool isImageName(QStringView name);
+
+    // Raw getdents64 listing of one directory, no stat and no QString per
+    // entry. Hidden names are skipped. False if it can't be opened.
+    static bool listNames(const QString &dir, const std::function<void(const char *name, size_t len)> &fn);
+
+    // statx of known names in dir, mtime and size filled in, the ones gone
+    // are removed. False if dir can't be opened.
+    static bool statFiles(const QString &dir, QList<ScannedFile> &files);
+
+private:
+    int m_threads;
+    int m_listedDirs = 0;
+    int m_statCalls = 0;
+};
@@ -1,46 +1,26 @@
 #pragma once
-#include <QWidget>
-#include <QTimer>
 #include <QList>
 #include <QRect>
-#include "cachedimage.h"
+#include "thumbnailgrid.h"
 
-extern int THUMB_HEIGHT;
+class GpuSurface;
+struct GpuTile;
 
-class QHppQ_GPU : public QWidget {
+class QHppQ_GPU : public ThumbnailGrid {
     Q_OBJECT
 public:
-    explicit QHppQ_GPU(const QString &cacheFolder, const QString &mainFolder, QWidget *parent = nullptr);
+    explicit QHppQ_GPU(ThumbnailLibrary *library, QWidget *parent = nullptr);
 
-    void loadPixmaps(const QList<CachedImage> &pixs);
-    QString currentMonitor() const { return m_currentMonitor; }
-    void setCurrentMonitor(const QString &monitor) { m_currentMonitor = monitor; }
-
-    int getThumbnailIndexAtY(int y);
-    int getYPositionOfThumbnail(int index);
+    // Hand drawing over to an OpenGL viewport, nullptr goes back to QPainter
+    void setSurface(GpuSurface *surface);
+    // Tiles intersecting view (grid coordinates) for the GL viewport's next frame
+    QList<GpuTile> visibleTiles(const QRect &view);
 
 protected:
     void paintEvent(QPaintEvent* event) override;
-    void resizeEvent(QResizeEvent* event) override;
-    void mousePressEvent(QMouseEvent* event) override;
-    void mouseMoveEvent(QMouseEvent* event) override;
+    void requestFrame(const QRect &rect = QRect()) override;
+    int maxTierHeight() const override;
 
 private:
-    QList<CachedImage> m_pixmaps;
-    QString m_cacheFolder;
-    QString m_mainFolder;
-    QString m_currentMonitor;
-
-    // Hover / click tracking
-    bool m_hovering = false;
-    CachedImage m_hoveredImage;
-    QRect m_hoveredRect;
-    QList<QRect> m_thumbnailRects;
-    int m_clickedIndex = -1;
-    qreal m_clickFlashProgress = 0.0;
-    QTimer hoverTimer;
-
-    void startHoverTimer();
-    void stopHoverTimer();
-    void drawRow(QPainter &painter, const QList<CachedImage> &rowPixmaps, int y, int rowWidth, int rowHeight);
+    GpuSurface *m_surface = nullptr;
 };
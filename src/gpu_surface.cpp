@@ -0,0 +1,209 @@
+// gpu_surface.cpp
+#include "gpu_surface.h"
+#include "gpu_renderer.h"
+#include <QOpenGLContext>
+#include <QSurfaceFormat>
+#include <QVector2D>
+#include <QDateTime>
+#include <QDebug>
+#include <QtMath>
+#include <cmath>
+
+// Cells per visible tile, the rest keeps what was just scrolled past resident
+static const int ATLAS_HEADROOM = 2;
+
+static const char *VERTEX_SHADER = R"(
+#version 330 core
+layout(location = 0) in vec2 aCorner;   // unit quad
+layout(location = 1) in vec4 aRect;     // x, y, w, h in viewport pixels
+layout(location = 2) in vec4 aUv;       // u0, v0, u1, v1
+layout(location = 3) in vec4 aParams;   // layer, opacity, flash, hovered
+uniform vec2 uViewport;
+out vec3 vUv;
+out vec3 vParams;
+void main() {
+    vec2 p = aRect.xy + aCorner * aRect.zw;
+    gl_Position = vec4(p.x / uViewport.x * 2.0 - 1.0, 1.0 - p.y / uViewport.y * 2.0, 0.0, 1.0);
+    vUv = vec3(mix(aUv.xy, aUv.zw, aCorner), aParams.x);
+    vParams = aParams.yzw;
+}
+)";
+
+// Same look as the QPainter path: 0.85 opacity, pulsing white on hover,
+// white flash on click, faint white box for slots still loading
+static const char *FRAGMENT_SHADER = R"(
+#version 330 core
+in vec3 vUv;
+in vec3 vParams;
+uniform sampler2DArray uAtlas;
+uniform float uTime;
+out vec4 fragColor;
+void main() {
+    if (vUv.z < 0.0) {
+        fragColor = vec4(20.0 / 255.0);
+        return;
+    }
+    vec4 c = texture(uAtlas, vUv);
+    float hover = vParams.z * (40.0 + 15.0 * sin(uTime / 100.0)) / 255.0;
+    c = mix(c, vec4(c.a), hover);           // white over the opaque part, premultiplied
+    c *= vParams.x;
+    float flash = vParams.y * 100.0 / 255.0;
+    fragColor = vec4(flash) + c * (1.0 - flash);
+}
+)";
+
+GpuSurface::GpuSurface(QWidget *parent)
+    : QOpenGLWidget(parent)
+{
+    QSurfaceFormat fmt = format();
+    fmt.setVersion(3, 3);
+    fmt.setProfile(QSurfaceFormat::CoreProfile);
+    fmt.setAlphaBufferSize(8);
+    setFormat(fmt);
+    setAttribute(Qt::WA_AlphaChannel); // see-through window like the QPainter path
+}
+
+GpuSurface::~GpuSurface() {
+    if (!m_ready) return;
+    makeCurrent();
+    cleanup();
+    doneCurrent();
+}
+
+void GpuSurface::initializeGL() {
+    initializeOpenGLFunctions();
+    connect(context(), &QOpenGLContext::aboutToBeDestroyed, this, [this](){
+        makeCurrent();
+        cleanup();
+        doneCurrent();
+    });
+
+    const QSurfaceFormat got = context()->format();
+    qDebug() << "OpenGL" << got.majorVersion() << "." << got.minorVersion()
+             << reinterpret_cast<const char *>(glGetString(GL_RENDERER));
+
+    m_ready = got.version() >= qMakePair(3, 3) &&
+              m_program.addShaderFromSourceCode(QOpenGLShader::Vertex, VERTEX_SHADER) &&
+              m_program.addShaderFromSourceCode(QOpenGLShader::Fragment, FRAGMENT_SHADER) &&
+              m_program.link();
+    if (!m_ready) {
+        // no usable GL 3.3, the grid goes back to painting with QPainter
+        qWarning() << "OpenGL 3.3 renderer unavailable, falling back to QPainter" << m_program.log();
+        if (m_grid) m_grid->setSurface(nullptr);
+        return;
+    }
+
+    static const float corners[] = { 0, 0,  1, 0,  0, 1,  1, 1 };
+
+    glGenVertexArrays(1, &m_vao);
+    glBindVertexArray(m_vao);
+
+    glGenBuffers(1, &m_quadBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, m_quadBuffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof corners, corners, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
+
+    glGenBuffers(1, &m_instanceBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+    for (int i = 0; i < 3; ++i) {
+        glEnableVertexAttribArray(1 + i);
+        glVertexAttribPointer(1 + i, 4, GL_FLOAT, GL_FALSE, sizeof(Instance),
+                              reinterpret_cast<const void *>(i * 4 * sizeof(float)));
+        glVertexAttribDivisor(1 + i, 1);
+    }
+    glBindVertexArray(0);
+}
+
+void GpuSurface::cleanup() {
+    if (!m_ready) return;
+    m_ready = false;
+    m_atlas.destroy();
+    glDeleteBuffers(1, &m_quadBuffer);
+    glDeleteBuffers(1, &m_instanceBuffer);
+    glDeleteVertexArrays(1, &m_vao);
+    m_program.removeAllShaders();
+    m_instanceCapacity = 0;
+}
+
+bool GpuSurface::ensureAtlas(const QList<GpuTile> &tiles) {
+    int rowHeight = 0;
+    for (const GpuTile &t : tiles) rowHeight = qMax(rowHeight, t.rect.height());
+    const int cellHeight = ThumbAtlas::cellHeightFor(qCeil(rowHeight * devicePixelRatioF()));
+
+    // rows taller than the cells would blur, a screenful that doesn't fit would
+    // evict itself every frame. Smaller rows keep the bigger cells while they fit
+    if (m_atlas.isCreated() && m_atlas.cellHeight() >= cellHeight && tiles.size() * ATLAS_HEADROOM <= m_atlasCells)
+        return true;
+
+    m_atlas.destroy();
+    m_atlasCells = qMax(1, int(tiles.size())) * ATLAS_HEADROOM;
+    if (m_atlas.create(cellHeight, m_atlasCells)) return true;
+
+    qWarning() << "Thumbnail atlas unavailable, falling back to QPainter";
+    cleanup();
+    if (m_grid) m_grid->setSurface(nullptr);
+    return false;
+}
+
+void GpuSurface::paintGL() {
+    glClearColor(0, 0, 0, 0);
+    glClear(GL_COLOR_BUFFER_BIT);
+    if (!m_ready || !m_grid) return;
+
+    // the scroll area moves the grid, its offset is our scroll position
+    const QRect view(-m_grid->pos(), size());
+    const QList<GpuTile> tiles = m_grid->visibleTiles(view);
+    ++m_frame;
+    if (!ensureAtlas(tiles)) return;
+
+    m_instances.resize(0);
+    m_instances.reserve(tiles.size());
+    for (const GpuTile &t : tiles) {
+        Instance in;
+        in.rect[0] = t.rect.x() - view.x();
+        in.rect[1] = t.rect.y() - view.y();
+        in.rect[2] = t.rect.width();
+        in.rect[3] = t.rect.height();
+
+        // uploaded once, after that it's just a cell lookup
+        const int cell = m_atlas.cellFor(t.pix, m_frame);
+        const QRectF uv = cell < 0 ? QRectF() : m_atlas.uvOf(cell);
+        in.uv[0] = uv.left();
+        in.uv[1] = uv.top();
+        in.uv[2] = uv.right();
+        in.uv[3] = uv.bottom();
+
+        in.params[0] = cell < 0 ? -1.0f : float(m_atlas.layerOf(cell));
+        in.params[1] = t.hovered ? 1.0f : t.opacity;
+        in.params[2] = t.flash;
+        in.params[3] = t.hovered ? 1.0f : 0.0f;
+        m_instances.append(in);
+    }
+    if (m_instances.isEmpty()) return;
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+    const int bytes = int(m_instances.size() * sizeof(Instance));
+    if (bytes > m_instanceCapacity) {
+        m_instanceCapacity = bytes * 2;
+        glBufferData(GL_ARRAY_BUFFER, m_instanceCapacity, nullptr, GL_STREAM_DRAW);
+    }
+    glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, m_instances.constData());
+
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA); // premultiplied
+
+    // wrapped to a whole number of pulse periods so the float keeps its precision
+    const double now = std::fmod(double(QDateTime::currentMSecsSinceEpoch()), 200.0 * M_PI * 1000.0);
+
+    m_program.bind();
+    m_program.setUniformValue("uViewport", QVector2D(width(), height()));
+    m_program.setUniformValue("uTime", float(now));
+    m_program.setUniformValue("uAtlas", 0);
+    m_atlas.bind(0);
+
+    glBindVertexArray(m_vao);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, m_instances.size());
+    glBindVertexArray(0);
+    m_program.release();
+}
@@ -0,0 +1,61 @@
+// gpu_surface.h
+#pragma once
+#include <QOpenGLWidget>
+#include <QOpenGLExtraFunctions>
+#include <QOpenGLShaderProgram>
+#include <QList>
+#include <QPixmap>
+#include <QRect>
+#include <QVector>
+#include "thumbatlas.h"
+
+class QHppQ_GPU;
+
+// One thumbnail (or reserved slot) to draw, in grid content coordinates
+struct GpuTile {
+    QRect rect;
+    QPixmap pix;            // null for a slot that is still loading
+    float opacity = 0.85f;
+    float flash = 0.0f;     // click flash, 0..1
+    bool hovered = false;
+};
+
+// OpenGL viewport of the GPU grid's scroll area. QHppQ_GPU stays the scrolled
+// widget for layout and mouse input but paints nothing itself, every frame is
+// drawn here: thumbnails come from a texture atlas and all visible tiles,
+// hover pulse and click flash included, go out in one instanced draw call.
+class GpuSurface : public QOpenGLWidget, protected QOpenGLExtraFunctions {
+    Q_OBJECT
+public:
+    explicit GpuSurface(QWidget *parent = nullptr);
+    ~GpuSurface();
+
+    void setGrid(QHppQ_GPU *grid) { m_grid = grid; }
+
+protected:
+    void initializeGL() override;
+    void paintGL() override;
+
+private:
+    QHppQ_GPU *m_grid = nullptr;
+    bool m_ready = false;
+
+    QOpenGLShaderProgram m_program;
+    GLuint m_vao = 0;
+    GLuint m_quadBuffer = 0;
+    GLuint m_instanceBuffer = 0;
+    int m_instanceCapacity = 0;
+    ThumbAtlas m_atlas;
+    int m_atlasCells = 0;       // asked for, sized from the visible tiles
+    quint64 m_frame = 0;
+
+    struct Instance {
+        float rect[4];      // x, y, w, h in viewport pixels
+        float uv[4];        // u0, v0, u1, v1
+        float params[4];    // atlas layer (-1 = placeholder), opacity, flash, hovered
+    };
+    QVector<Instance> m_instances;
+
+    bool ensureAtlas(const QList<GpuTile> &tiles);
+    void cleanup();
+};
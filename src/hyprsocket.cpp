@@ -0,0 +1,139 @@
+// hyprsocket.cpp
+#include "hyprsocket.h"
+#include <QElapsedTimer>
+#include <QFile>
+#include <QProcess>
+#include <QDebug>
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace HyprSocket {
+
+static const int CONNECT_RETRY_MS = 5;
+static const int HYPRCTL_TIMEOUT_MS = 1000;
+
+QString socketDir() {
+    const QString overrideDir = qEnvironmentVariable("QTHYPRPAPER_HYPR_DIR");
+    if (!overrideDir.isEmpty()) return overrideDir;
+
+    const QString signature = qEnvironmentVariable("HYPRLAND_INSTANCE_SIGNATURE");
+    if (signature.isEmpty()) return QString();
+    QString runtime = qEnvironmentVariable("XDG_RUNTIME_DIR");
+    if (runtime.isEmpty()) runtime = "/tmp"; // Hyprland before 0.40 kept them in /tmp/hypr
+    return runtime + "/hypr/" + signature;
+}
+
+QString socketPath(Target target) {
+    const QString dir = socketDir();
+    if (dir.isEmpty()) return QString();
+    switch (target) {
+    case Hyprland: return dir + "/.socket.sock";
+    case HyprlandEvents: return dir + "/.socket2.sock";
+    case Hyprpaper: break;
+    }
+    return dir + "/.hyprpaper.sock";
+}
+
+// Wait for fd to become ready, false on timeout
+static bool waitFor(int fd, short events, QElapsedTimer &clock, int timeoutMs) {
+    for (;;) {
+        const int left = timeoutMs - int(clock.elapsed());
+        if (left <= 0) return false;
+        pollfd p{fd, events, 0};
+        const int r = ::poll(&p, 1, left);
+        if (r > 0) return true;
+        if (r == 0 || errno != EINTR) return false;
+    }
+}
+
+static int connectTo(const QByteArray &path, QElapsedTimer &clock, int timeoutMs) {
+    sockaddr_un addr{};
+    if (path.isEmpty() || size_t(path.size()) >= sizeof addr.sun_path) return -1;
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, path.constData(), size_t(path.size()));
+
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (fd < 0) return -1;
+
+    // UNIX sockets connect right away or not at all, EAGAIN means the server's
+    // backlog is full and there is nothing to poll for, so just try again
+    for (;;) {
+        if (::connect(fd, reinterpret_cast<const sockaddr *>(&addr), sizeof addr) == 0) return fd;
+        if (errno == EINTR) continue;
+        if (errno != EAGAIN || clock.elapsed() + CONNECT_RETRY_MS > timeoutMs) break;
+        ::poll(nullptr, 0, CONNECT_RETRY_MS);
+    }
+    ::close(fd);
+    return -1;
+}
+
+int open(Target target, int timeoutMs) {
+    QElapsedTimer clock;
+    clock.start();
+    return connectTo(QFile::encodeName(socketPath(target)), clock, timeoutMs);
+}
+
+bool request(Target target, const QByteArray &req, QByteArray &reply, int timeoutMs) {
+    reply.clear();
+    const QByteArray path = QFile::encodeName(socketPath(target));
+
+    QElapsedTimer clock;
+    clock.start();
+    const int fd = connectTo(path, clock, timeoutMs);
+    if (fd < 0) {
+        qDebug() << "Hypr socket" << path << "not reachable";
+        return false;
+    }
+    bool ok = true;
+
+    // the whole request first, the servers read it in one go
+    qint64 sent = 0;
+    while (ok && sent < req.size()) {
+        const ssize_t n = ::send(fd, req.constData() + sent, size_t(req.size() - sent), MSG_NOSIGNAL);
+        if (n > 0) sent += n;
+        else if (n < 0 && errno == EAGAIN) ok = waitFor(fd, POLLOUT, clock, timeoutMs);
+        else if (n < 0 && errno == EINTR) continue;
+        else ok = false;
+    }
+
+    // then everything until they close the connection
+    char buffer[8192];
+    while (ok) {
+        const ssize_t n = ::recv(fd, buffer, sizeof buffer, 0);
+        if (n > 0) reply.append(buffer, int(n));
+        else if (n == 0) break;
+        else if (errno == EAGAIN) ok = waitFor(fd, POLLIN, clock, timeoutMs);
+        else if (errno != EINTR) ok = false;
+    }
+
+    ::close(fd);
+    if (!ok) qDebug() << "Hypr socket" << path << "request" << req.left(32) << "failed after" << clock.elapsed() << "ms";
+    return ok;
+}
+
+QString call(Target target, const QByteArray &req, const QStringList &hyprctlArgs) {
+    const QString path = socketPath(target);
+    if (!path.isEmpty() && QFile::exists(path)) {
+        QByteArray reply;
+        request(target, req, reply);
+        return QString::fromUtf8(reply);
+    }
+
+    // no socket (not under Hyprland, or hyprpaper without ipc), let hyprctl sort it out
+    QProcess p;
+    p.start("hyprctl", hyprctlArgs);
+    if (!p.waitForFinished(HYPRCTL_TIMEOUT_MS)) {
+        // hung or never started, an empty reply is a failure to every caller
+        qDebug() << "hyprctl" << hyprctlArgs << "gave up after" << HYPRCTL_TIMEOUT_MS << "ms";
+        p.kill();
+        p.waitForFinished();
+        return QString();
+    }
+    return QString::fromUtf8(p.readAllStandardOutput() + p.readAllStandardError());
+}
+
+} // namespace HyprSocket
@@ -0,0 +1,30 @@
+// hyprsocket.h
+#pragma once
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+
+// Talks to Hyprland and hyprpaper over their UNIX sockets, the same
+// one-request-per-connection protocol hyprctl speaks, so a click costs a
+// connect + write + read instead of a fork/exec of hyprctl.
+namespace HyprSocket {
+
+enum Target { Hyprland, Hyprpaper, HyprlandEvents };
+
+// $QTHYPRPAPER_HYPR_DIR if set (stand-in server, see tools/), otherwise
+// $XDG_RUNTIME_DIR/hypr/$HYPRLAND_INSTANCE_SIGNATURE
+QString socketDir();
+QString socketPath(Target target);
+
+// Connected nonblocking socket, -1 if it isn't there or doesn't answer within
+// timeoutMs. For HyprlandEvents, which streams "EVENT>>DATA" lines until closed
+int open(Target target, int timeoutMs = 1000);
+
+// Send one request and read the reply until the server hangs up.
+// False if the socket isn't there or nobody answers within timeoutMs.
+bool request(Target target, const QByteArray &req, QByteArray &reply, int timeoutMs = 1000);
+
+// request(), or hyprctl with hyprctlArgs when there is no socket to talk to
+QString call(Target target, const QByteArray &req, const QStringList &hyprctlArgs);
+
+} // namespace HyprSocket
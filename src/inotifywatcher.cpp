@@ -1,13 +1,23 @@
 // inotifywatcher.cpp
 #include "inotifywatcher.h"
 #include <sys/inotify.h>
+#include <sys/stat.h>
 #include <unistd.h>
+#include <QDirIterator>
+#include <QFile>
 #include <QDebug>
+#include <algorithm>
+
+static const uint32_t WATCH_MASK = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+                                   IN_CLOSE_WRITE | IN_ONLYDIR | IN_EXCL_UNLINK;
+
+// How long an IN_MOVED_FROM waits for its IN_MOVED_TO before it counts as a delete
+static const int MOVE_PAIR_MS = 20;
 
 InotifyWatcher::InotifyWatcher(const QString &path, QObject *parent)
     : QObject(parent)
 {
-    fd = inotify_init1(IN_NONBLOCK);
+    fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
     if (fd < 0) {
         perror("inotify_init1");
         return;
@@ -17,6 +27,9 @@ InotifyWatcher::InotifyWatcher(const QString &path, QObject *parent)
 
     notifier = new QSocketNotifier(fd, QSocketNotifier::Read, this);
     connect(notifier, &QSocketNotifier::activated, this, &InotifyWatcher::processEvents);
+
+    moveTimer.setSingleShot(true);
+    connect(&moveTimer, &QTimer::timeout, this, &InotifyWatcher::flushPendingMoves);
 }
 
 InotifyWatcher::~InotifyWatcher() {
@@ -24,31 +37,202 @@ InotifyWatcher::~InotifyWatcher() {
     if (fd >= 0) close(fd);
 }
 
-void InotifyWatcher::addWatch(const QString &path) {
-    int wd = inotify_add_watch(fd, path.toUtf8().constData(),
-                               IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO);
+qint64 InotifyWatcher::dirMtime(const QString &path) const {
+    struct stat st;
+    if (::stat(QFile::encodeName(path).constData(), &st) != 0) return -1;
+    return qint64(st.st_mtim.tv_sec) * 1000000000LL + st.st_mtim.tv_nsec;
+}
+
+int InotifyWatcher::addSingleWatch(const QString &path) {
+    int wd = inotify_add_watch(fd, QFile::encodeName(path).constData(), WATCH_MASK);
     if (wd < 0) {
         perror("inotify_add_watch");
-    } else {
-        watchDescriptors[wd] = path;
+        return -1;
+    }
+
+    // same inode under a new name gives back the same wd
+    auto old = watchDescriptors.constFind(wd);
+    if (old != watchDescriptors.constEnd() && old.value() != path) watchedPaths.remove(old.value());
+
+    watchDescriptors[wd] = path;
+    watchedPaths[path] = wd;
+    dirMtimes[wd] = dirMtime(path);
+    return wd;
+}
+
+void InotifyWatcher::addWatch(const QString &path) {
+    if (fd < 0) return;
+    if (addSingleWatch(path) < 0) return;
+
+    QDirIterator it(path, QDir::Dirs | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+    while (it.hasNext()) addSingleWatch(it.next());
+}
+
+void InotifyWatcher::removeWatchesUnder(const QString &path) {
+    const QString prefix = path + "/";
+    QList<QString> gone;
+    for (auto it = watchedPaths.cbegin(); it != watchedPaths.cend(); ++it) {
+        if (it.key() == path || it.key().startsWith(prefix)) gone.append(it.key());
+    }
+    for (const QString &p : gone) {
+        int wd = watchedPaths.take(p);
+        inotify_rm_watch(fd, wd); // fails harmlessly if the kernel already dropped it
+        watchDescriptors.remove(wd);
+        dirMtimes.remove(wd);
+    }
+}
+
+void InotifyWatcher::renameWatchesUnder(const QString &from, const QString &to) {
+    const QString prefix = from + "/";
+    QList<QPair<QString, int>> moved;
+    for (auto it = watchedPaths.cbegin(); it != watchedPaths.cend(); ++it) {
+        if (it.key() == from || it.key().startsWith(prefix)) moved.append({it.key(), it.value()});
+    }
+    for (const auto &m : moved) {
+        const QString newPath = to + m.first.mid(from.size());
+        watchedPaths.remove(m.first);
+        watchedPaths[newPath] = m.second;
+        watchDescriptors[m.second] = newPath;
     }
 }
 
 void InotifyWatcher::processEvents() {
-    char buf[4096]
-        __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    static_assert(alignof(struct inotify_event) <= alignof(quint32), "event buffer misaligned");
+    char *buf = eventBuffer;
     ssize_t len;
 
-    while ((len = read(fd, buf, sizeof buf)) > 0) {
+    QSet<int> touched;
+    bool overflow = false;
+
+    while ((len = read(fd, buf, EVENT_BUFFER_SIZE)) > 0) {
         for (char *ptr = buf; ptr < buf + len; ) {
-            struct inotify_event *event = (struct inotify_event *) ptr;
-            QString base = watchDescriptors[event->wd];
-            QString full = base + "/" + QString::fromUtf8(event->name);
+            const struct inotify_event *event = (const struct inotify_event *) ptr;
+            ptr += sizeof(struct inotify_event) + event->len;
 
-            if (event->mask & (IN_CREATE | IN_MOVED_TO)) emit fileCreated(full);
-            if (event->mask & (IN_DELETE | IN_MOVED_FROM)) emit fileDeleted(full);
+            if (event->mask & IN_Q_OVERFLOW) {
+                overflow = true;
+                continue;
+            }
+            if (event->mask & IN_IGNORED) {
+                // watch is gone (directory deleted or unmounted)
+                const QString path = watchDescriptors.take(event->wd);
+                if (!path.isEmpty() && watchedPaths.value(path, -1) == event->wd) watchedPaths.remove(path);
+                dirMtimes.remove(event->wd);
+                continue;
+            }
 
-            ptr += sizeof(struct inotify_event) + event->len;
+            auto wit = watchDescriptors.constFind(event->wd);
+            if (wit == watchDescriptors.constEnd() || event->len == 0) continue;
+            touched.insert(event->wd);
+
+            const QString full = wit.value() + "/" + QString::fromUtf8(event->name);
+            const bool isDir = event->mask & IN_ISDIR;
+
+            if (event->mask & IN_MOVED_FROM) {
+                pendingMoves.insert(event->cookie, {full, isDir});
+                continue;
+            }
+
+            if (event->mask & IN_MOVED_TO) {
+                auto pit = pendingMoves.find(event->cookie);
+                if (pit != pendingMoves.end()) {
+                    const PendingMove from = pit.value();
+                    pendingMoves.erase(pit);
+                    if (isDir) {
+                        renameWatchesUnder(from.path, full);
+                        emit directoryRenamed(from.path, full);
+                    } else {
+                        emit fileRenamed(from.path, full);
+                    }
+                } else if (isDir) {
+                    // moved in from outside the tree
+                    addWatch(full);
+                    emit directoryRescanNeeded(full);
+                } else {
+                    emit fileCreated(full);
+                }
+                continue;
+            }
+
+            if (event->mask & IN_CREATE) {
+                if (isDir) {
+                    // files may land in it before the watch is up, so list it once too
+                    addWatch(full);
+                    emit directoryRescanNeeded(full);
+                } else {
+                    emit fileCreated(full);
+                }
+            }
+            if (event->mask & IN_DELETE) {
+                if (isDir) {
+                    removeWatchesUnder(full);
+                    emit directoryRemoved(full);
+                } else {
+                    emit fileDeleted(full);
+                }
+            }
+            if ((event->mask & IN_CLOSE_WRITE) && !isDir) emit fileChanged(full);
         }
     }
+
+    if (overflow) {
+        // compared against the mtimes from before this read: a directory that had
+        // events in it too has lost some of them, so it must still look changed
+        recoverFromOverflow();
+        return;
+    }
+
+    // remember where we are, so an overflow later only rescans what changed after this
+    for (int wd : std::as_const(touched)) {
+        auto it = watchDescriptors.constFind(wd);
+        if (it != watchDescriptors.constEnd()) dirMtimes[wd] = dirMtime(it.value());
+    }
+
+    if (!pendingMoves.isEmpty()) moveTimer.start(MOVE_PAIR_MS);
+}
+
+void InotifyWatcher::flushPendingMoves() {
+    // moved out of the watched tree
+    const QHash<quint32, PendingMove> moves = pendingMoves;
+    pendingMoves.clear();
+    for (const PendingMove &m : moves) {
+        if (m.isDir) {
+            removeWatchesUnder(m.path);
+            emit directoryRemoved(m.path);
+        } else {
+            emit fileDeleted(m.path);
+        }
+    }
+}
+
+void InotifyWatcher::recoverFromOverflow() {
+    qWarning() << "inotify queue overflowed, rescanning changed directories";
+
+    // the other half of these moves may have been dropped
+    moveTimer.stop();
+    flushPendingMoves();
+
+    QStringList changed;
+    QStringList removed;
+    for (auto it = watchDescriptors.cbegin(); it != watchDescriptors.cend(); ++it) {
+        qint64 mtime = dirMtime(it.value());
+        if (mtime < 0) removed.append(it.value());
+        else if (mtime != dirMtimes.value(it.key())) changed.append(it.value());
+    }
+
+    for (const QString &dir : std::as_const(removed)) {
+        if (!watchedPaths.contains(dir)) continue; // parent already took it down
+        removeWatchesUnder(dir);
+        emit directoryRemoved(dir);
+    }
+
+    // a subtree rescan covers everything below it, drop nested ones
+    std::sort(changed.begin(), changed.end());
+    QString last;
+    for (const QString &dir : std::as_const(changed)) {
+        if (!last.isEmpty() && dir.startsWith(last + "/")) continue;
+        last = dir;
+        addWatch(dir); // picks up subdirectories we never heard about
+        emit directoryRescanNeeded(dir);
+    }
 }
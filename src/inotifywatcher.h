@@ -2,26 +2,60 @@
 #pragma once
 #include <QObject>
 #include <QHash>
+#include <QSet>
 #include <QSocketNotifier>
 #include <QString>
+#include <QTimer>
 
+// Watches a whole directory tree. Subdirectories are picked up as they are
+// created or moved in, renames are reported once via the move cookie and a
+// queue overflow turns into rescans of only the directories that changed.
 class InotifyWatcher : public QObject {
     Q_OBJECT
 public:
     explicit InotifyWatcher(const QString &path, QObject *parent = nullptr);
     ~InotifyWatcher();
 
+    // Watch path and every directory below it
     void addWatch(const QString &path);
 
 signals:
     void fileCreated(const QString &path);
     void fileDeleted(const QString &path);
+    void fileRenamed(const QString &from, const QString &to);
+    void fileChanged(const QString &path);  // closed after writing
+
+    void directoryRenamed(const QString &from, const QString &to);
+    void directoryRemoved(const QString &path);
+    // Events for this subtree may have been missed (new directory, overflow),
+    // list it again to catch up
+    void directoryRescanNeeded(const QString &path);
 
 private slots:
     void processEvents();
+    void flushPendingMoves();
 
 private:
+    struct PendingMove {
+        QString path;
+        bool isDir;
+    };
+
+    // Big enough to drain a burst of a few thousand events in one read()
+    static const size_t EVENT_BUFFER_SIZE = 64 * 1024;
+
     int fd;
-    QSocketNotifier *notifier;
+    alignas(quint32) char eventBuffer[EVENT_BUFFER_SIZE];
+    QSocketNotifier *notifier = nullptr;
     QHash<int, QString> watchDescriptors;
+    QHash<QString, int> watchedPaths;
+    QHash<int, qint64> dirMtimes;           // per watch, for overflow recovery
+    QHash<quint32, PendingMove> pendingMoves; // IN_MOVED_FROM waiting for its IN_MOVED_TO
+    QTimer moveTimer;
+
+    int addSingleWatch(const QString &path);
+    void removeWatchesUnder(const QString &path);
+    void renameWatchesUnder(const QString &from, const QString &to);
+    void recoverFromOverflow();
+    qint64 dirMtime(const QString &path) const;
 };
@@ -0,0 +1,414 @@
+// libraryindex.cpp
+#include "libraryindex.h"
+#include "dirscanner.h"
+#include "thumbnailcacheset.h"
+#include "pngtext.h"
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QImageReader>
+#include <QSaveFile>
+#include <QDebug>
+#include <algorithm>
+#include <cstring>
+
+// -------------------------------
+// On-disk layout
+// -------------------------------
+// header | DirRecord[dirCount] | EntryRecord[entryCount] | utf8 string blob
+// Bump INDEX_VERSION whenever any of the records below change.
+
+static const char INDEX_MAGIC[4] = {'Q', 'H', 'P', 'I'};
+static const quint32 INDEX_VERSION = 2;   // 2: images only
+
+// Entries handed out per refresh() chunk, a few hundred slots per model update
+static const int CHUNK_ENTRIES = 512;
+
+enum EntryFlags : quint32 {
+    ENTRY_CACHED = 1u << 0,
+    ENTRY_STALE  = 1u << 1,
+};
+
+struct IndexHeader {
+    char magic[4];
+    quint32 version;
+    quint32 dirCount;
+    quint32 entryCount;
+    quint32 stringBytes;
+    quint32 rootOffset;
+    quint32 rootLen;
+    quint32 cacheOffset;
+    quint32 cacheLen;
+    quint32 reserved;
+};
+
+struct DirRecord {
+    qint64 mtime;
+    quint32 pathOffset;
+    quint32 pathLen;
+    qint32 parent;
+    quint32 firstEntry;
+    quint32 entryCount;
+    quint32 reserved;
+};
+
+struct EntryRecord {
+    qint64 mtime;
+    qint64 size;
+    quint32 nameOffset;
+    quint32 nameLen;
+    quint8 md5[16];
+    quint16 thumbWidth;
+    quint16 thumbHeight;
+    quint32 flags;
+};
+
+static_assert(sizeof(IndexHeader) == 40, "index header layout changed");
+static_assert(sizeof(DirRecord) == 32, "index dir record layout changed");
+static_assert(sizeof(EntryRecord) == 48, "index entry record layout changed");
+
+LibraryIndex::LibraryIndex(const QString &indexPath)
+    : m_indexPath(indexPath)
+{
+}
+
+QByteArray LibraryIndex::uriMd5(const QString &absoluteFilePath) {
+    QByteArray uri = ("file://" + absoluteFilePath).toUtf8();
+    return QCryptographicHash::hash(uri, QCryptographicHash::Md5);
+}
+
+bool libraryOrderLess(const QString &a, const QString &b) {
+    const int slashA = a.lastIndexOf('/');
+    const int slashB = b.lastIndexOf('/');
+    const QStringView dirA = QStringView(a).left(qMax(0, slashA));
+    const QStringView dirB = QStringView(b).left(qMax(0, slashB));
+
+    if (dirA != dirB) {
+        // component-wise, so a parent (and its files) sorts before its subfolders
+        const auto partsA = dirA.split(u'/');
+        const auto partsB = dirB.split(u'/');
+        const int n = qMin(partsA.size(), partsB.size());
+        for (int i = 0; i < n; ++i) {
+            if (partsA[i] != partsB[i]) return partsA[i] < partsB[i];
+        }
+        return partsA.size() < partsB.size();
+    }
+    return QStringView(a).mid(slashA + 1) < QStringView(b).mid(slashB + 1);
+}
+
+// The last run's index, read straight out of the mapping. Nothing is copied
+// up front, a dir's entries are only turned into LibraryEntry when asked for.
+class MappedIndex {
+public:
+    bool open(const QString &indexPath, const QString &mainFolder, const QString &cacheFolder) {
+        m_file.setFileName(indexPath);
+        if (!m_file.open(QIODevice::ReadOnly)) return false;
+
+        const qint64 fileSize = m_file.size();
+        if (fileSize < qint64(sizeof(IndexHeader))) return false;
+
+        const uchar *base = m_file.map(0, fileSize);
+        if (!base) return false;
+        std::memcpy(&m_header, base, sizeof m_header);
+
+        const qint64 dirsAt    = sizeof(IndexHeader);
+        const qint64 entriesAt = dirsAt + qint64(m_header.dirCount) * sizeof(DirRecord);
+        const qint64 stringsAt = entriesAt + qint64(m_header.entryCount) * sizeof(EntryRecord);
+
+        if (std::memcmp(m_header.magic, INDEX_MAGIC, 4) != 0 || m_header.version != INDEX_VERSION ||
+            stringsAt + m_header.stringBytes != fileSize) {
+            qDebug() << "Library index" << indexPath << "is stale or damaged, rebuilding";
+            return false;
+        }
+
+        m_dirs = reinterpret_cast<const DirRecord *>(base + dirsAt);
+        m_entries = reinterpret_cast<const EntryRecord *>(base + entriesAt);
+        m_strings = reinterpret_cast<const char *>(base + stringsAt);
+
+        // A different library or cache location invalidates everything
+        if (str(m_header.rootOffset, m_header.rootLen) != mainFolder ||
+            str(m_header.cacheOffset, m_header.cacheLen) != cacheFolder)
+            return false;
+
+        for (quint32 d = 0; d < m_header.dirCount; ++d)
+            if (quint64(m_dirs[d].firstEntry) + m_dirs[d].entryCount > m_header.entryCount) return false;
+        m_dirCount = int(m_header.dirCount);
+        return true;
+    }
+
+    int dirCount() const { return m_dirCount; }
+    QString path(int d) const { return str(m_dirs[d].pathOffset, m_dirs[d].pathLen); }
+    qint64 mtime(int d) const { return m_dirs[d].mtime; }
+    int parent(int d) const { return m_dirs[d].parent; }
+    int fileCount(int d) const { return int(m_dirs[d].entryCount); }
+
+    // File i of dir d, which lives at dirPath
+    LibraryEntry entry(int d, int i, const QString &dirPath, const QString &folder) const {
+        const EntryRecord &e = m_entries[m_dirs[d].firstEntry + i];
+        LibraryEntry entry;
+        entry.filePath = dirPath + "/" + str(e.nameOffset, e.nameLen);
+        entry.folder = folder;
+        entry.md5 = QByteArray(reinterpret_cast<const char *>(e.md5), 16);
+        entry.mtime = e.mtime;
+        entry.size = e.size;
+        if (e.thumbWidth > 0 && e.thumbHeight > 0)
+            entry.thumbSize = QSize(e.thumbWidth, e.thumbHeight);
+        entry.cached = e.flags & ENTRY_CACHED;
+        entry.stale = e.flags & ENTRY_STALE;
+        return entry;
+    }
+
+private:
+    QString str(quint32 off, quint32 len) const {
+        if (quint64(off) + len > m_header.stringBytes) return QString();
+        return QString::fromUtf8(m_strings + off, int(len));
+    }
+
+    QFile m_file;   // unmapped when it goes away
+    IndexHeader m_header{};
+    const DirRecord *m_dirs = nullptr;
+    const EntryRecord *m_entries = nullptr;
+    const char *m_strings = nullptr;
+    int m_dirCount = 0;
+};
+
+void LibraryIndex::recheck(LibraryEntry &e, const ThumbnailCacheSet &cache, bool edited) {
+    const bool cached = cache.contains(e.md5);
+    if (cached == e.cached && !e.stale && !edited) return;
+
+    // thumbnails may have appeared, been cleaned up or regenerated since
+    const bool stale = cached && isThumbnailStale(e.cachedPath(m_cacheFolder), e.mtime, e.size);
+    if (cached && !e.cached) e.thumbSize = QImageReader(e.cachedPath(m_cacheFolder)).size();
+    if (cached != e.cached || stale != e.stale) m_dirty = true;
+    e.cached = cached;
+    e.stale = stale;
+}
+
+QList<LibraryEntry> LibraryIndex::refresh(const QString &mainFolder, const QString &cacheFolder,
+                                          const ThumbnailCacheSet &cache, const EntriesFn &chunk) {
+    m_mainFolder = QDir(mainFolder).absolutePath();
+    m_cacheFolder = cacheFolder;
+    m_reusedDirs = 0;
+    m_rescannedDirs = 0;
+    m_dirty = false;
+
+    MappedIndex old;
+    const int oldCount = old.open(m_indexPath, m_mainFolder, m_cacheFolder) ? old.dirCount() : 0;
+
+    // dir paths only, their files stay in the mapping until a dir is used
+    QStringList oldPaths;
+    QHash<QString, int> oldByPath;
+    oldPaths.reserve(oldCount);
+    oldByPath.reserve(oldCount);
+    for (int i = 0; i < oldCount; ++i) {
+        oldPaths.append(old.path(i));
+        oldByPath.insert(oldPaths[i], i);
+    }
+
+    // children per old dir, so unchanged dirs can be descended without listing them
+    QList<QList<int>> oldChildren(oldCount);
+    for (int i = 0; i < oldCount; ++i)
+        if (old.parent(i) >= 0 && old.parent(i) < oldCount) oldChildren[old.parent(i)].append(i);
+
+    m_dirs.clear();
+
+    // Unchanged dirs (same mtime) aren't listed, their old subfolders are walked instead.
+    // Runs on the scanner's workers, old/oldByPath/oldChildren are only read from here on.
+    DirScanner scanner;
+    const QList<ScannedDir> scanned = scanner.scan(m_mainFolder, [&](const QString &path, qint64 mtime,
+                                                                     QStringList &subdirs){
+        const int oldIdx = oldByPath.value(path, -1);
+        if (oldIdx < 0 || old.mtime(oldIdx) != mtime) return false;
+        for (int child : oldChildren[oldIdx]) subdirs.append(oldPaths[child]);
+        return true;
+    });
+
+    // m_dirs from sentDirs on haven't been handed to chunk yet, unsent entries in them
+    int sentDirs = 0;
+    int unsent = 0;
+    auto sendChunk = [&]() {
+        if (!chunk || unsent == 0) return;
+        QList<LibraryEntry> entries;
+        entries.reserve(unsent);
+        for (; sentDirs < m_dirs.size(); ++sentDirs) entries.append(m_dirs[sentDirs].files);
+        unsent = 0;
+        chunk(entries);
+    };
+
+    for (const ScannedDir &sd : scanned) {
+        Dir dir;
+        dir.path = sd.path;
+        dir.mtime = sd.mtime;
+        dir.parent = sd.parent;
+        const int oldIdx = oldByPath.value(dir.path, -1);
+        const QString folder = QDir(dir.path).dirName();
+
+        if (!sd.listed) {
+            // Unchanged: nothing was added, removed or renamed in here. Files written
+            // over in place are left to checkFiles(), nothing is stat'ed on the way in
+            ++m_reusedDirs;
+            dir.reused = true;
+            const int count = old.fileCount(oldIdx);
+            dir.files.reserve(count);
+            for (int i = 0; i < count; ++i) {
+                LibraryEntry e = old.entry(oldIdx, i, dir.path, folder);
+                recheck(e, cache, false);
+                dir.files.append(e);
+            }
+        } else {
+            ++m_rescannedDirs;
+            m_dirty = true;
+
+            QHash<QString, LibraryEntry> previous;
+            if (oldIdx >= 0) {
+                for (int i = 0; i < old.fileCount(oldIdx); ++i) {
+                    const LibraryEntry e = old.entry(oldIdx, i, dir.path, folder);
+                    previous.insert(e.filePath, e);
+                }
+            }
+
+            dir.files.reserve(sd.files.size());
+            for (const ScannedFile &f : sd.files) {
+                LibraryEntry e;
+                e.filePath = dir.path + "/" + f.name;
+                e.folder = folder;
+                e.mtime = f.mtime;
+                e.size = f.size;
+
+                const auto prev = previous.constFind(e.filePath);
+                const bool known = prev != previous.cend();
+                const bool unchanged = known && prev->mtime == e.mtime && prev->size == e.size;
+                if (known) {
+                    e.md5 = prev->md5; // the md5 only depends on the path
+                    if (unchanged) e.thumbSize = prev->thumbSize;
+                } else {
+                    e.md5 = uriMd5(e.filePath);
+                }
+
+                e.cached = cache.contains(e.md5);
+                // new or edited file: its thumbnail's tEXt says which version it was made from
+                if (e.cached) {
+                    e.stale = unchanged && prev->cached ? prev->stale
+                                                        : isThumbnailStale(e.cachedPath(m_cacheFolder), e.mtime, e.size);
+                }
+                if (e.cached && !e.thumbSize.isValid())
+                    e.thumbSize = QImageReader(e.cachedPath(m_cacheFolder)).size(); // header only
+                dir.files.append(e);
+            }
+        }
+
+        unsent += int(dir.files.size());
+        m_dirs.append(dir);
+        if (unsent >= CHUNK_ENTRIES) sendChunk();
+    }
+    sendChunk();
+
+    if (m_dirs.size() != oldCount) m_dirty = true; // a directory disappeared
+
+    qDebug() << "Library index:" << m_reusedDirs << "dirs reused," << m_rescannedDirs << "rescanned,"
+             << scanner.statCalls() << "stats";
+    return entries();
+}
+
+int LibraryIndex::checkFiles(const ThumbnailCacheSet &cache) {
+    int changed = 0;
+    for (Dir &dir : m_dirs) {
+        if (!dir.reused) continue;
+
+        const int prefix = dir.path.size() + 1;
+        QList<ScannedFile> files;
+        files.reserve(dir.files.size());
+        for (const LibraryEntry &e : std::as_const(dir.files)) files.append({e.filePath.mid(prefix)});
+        if (!DirScanner::statFiles(dir.path, files)) continue;
+
+        // same order as the entries, minus the ones that are gone
+        QList<LibraryEntry> kept;
+        kept.reserve(files.size());
+        int next = 0;
+        for (LibraryEntry &e : dir.files) {
+            if (next >= files.size() || files[next].name != QStringView(e.filePath).mid(prefix)) {
+                ++changed;
+                continue;
+            }
+            const ScannedFile &f = files[next++];
+            if (f.mtime != e.mtime || f.size != e.size) {
+                e.mtime = f.mtime;
+                e.size = f.size;
+                recheck(e, cache, true);
+                ++changed;
+            }
+            kept.append(e);
+        }
+        dir.files = kept;
+        dir.reused = false;
+    }
+    if (changed) m_dirty = true;
+    return changed;
+}
+
+QList<LibraryEntry> LibraryIndex::entries() const {
+    QList<LibraryEntry> all;
+    for (const Dir &dir : m_dirs) all.append(dir.files);
+    return all;
+}
+
+bool LibraryIndex::save() const {
+    QByteArray strings;
+    auto addString = [&](const QString &s, quint32 &off, quint32 &len) {
+        const QByteArray utf8 = s.toUtf8();
+        off = quint32(strings.size());
+        len = quint32(utf8.size());
+        strings.append(utf8);
+    };
+
+    IndexHeader h{};
+    std::memcpy(h.magic, INDEX_MAGIC, 4);
+    h.version = INDEX_VERSION;
+    addString(m_mainFolder, h.rootOffset, h.rootLen);
+    addString(m_cacheFolder, h.cacheOffset, h.cacheLen);
+
+    QList<DirRecord> dirRecords;
+    QList<EntryRecord> entryRecords;
+    dirRecords.reserve(m_dirs.size());
+
+    for (const Dir &dir : m_dirs) {
+        DirRecord d{};
+        d.mtime = dir.mtime;
+        d.parent = dir.parent;
+        d.firstEntry = quint32(entryRecords.size());
+        d.entryCount = quint32(dir.files.size());
+        addString(dir.path, d.pathOffset, d.pathLen);
+        dirRecords.append(d);
+
+        const int prefix = dir.path.size() + 1;
+        for (const LibraryEntry &e : dir.files) {
+            EntryRecord r{};
+            r.mtime = e.mtime;
+            r.size = e.size;
+            addString(e.filePath.mid(prefix), r.nameOffset, r.nameLen);
+            std::memcpy(r.md5, e.md5.constData(), qMin<int>(16, e.md5.size()));
+            r.thumbWidth = quint16(qBound(0, e.thumbSize.width(), 0xffff));
+            r.thumbHeight = quint16(qBound(0, e.thumbSize.height(), 0xffff));
+            r.flags = (e.cached ? ENTRY_CACHED : 0) | (e.stale ? ENTRY_STALE : 0);
+            entryRecords.append(r);
+        }
+    }
+
+    h.dirCount = quint32(dirRecords.size());
+    h.entryCount = quint32(entryRecords.size());
+    h.stringBytes = quint32(strings.size());
+
+    QDir().mkpath(QFileInfo(m_indexPath).absolutePath());
+    QSaveFile f(m_indexPath);
+    if (!f.open(QIODevice::WriteOnly)) {
+        qWarning() << "Failed to write" << m_indexPath;
+        return false;
+    }
+    f.write(reinterpret_cast<const char *>(&h), sizeof h);
+    f.write(reinterpret_cast<const char *>(dirRecords.constData()), dirRecords.size() * sizeof(DirRecord));
+    f.write(reinterpret_cast<const char *>(entryRecords.constData()), entryRecords.size() * sizeof(EntryRecord));
+    f.write(strings);
+    return f.commit();
+}
@@ -0,0 +1,79 @@
+// libraryindex.h
+#pragma once
+#include <QByteArray>
+#include <QList>
+#include <QSize>
+#include <QString>
+#include <functional>
+#include "paths.h"
+
+class ThumbnailCacheSet;
+
+// Everything we know about one wallpaper without touching the disk again
+struct LibraryEntry {
+    QString filePath;
+    QString folder;
+    QByteArray md5;         // raw 16 bytes of md5("file://" + filePath)
+    qint64 mtime = 0;       // source file mtime, nanoseconds
+    qint64 size = 0;        // source file size
+    QSize thumbSize;        // cached thumbnail dimensions, invalid if unknown
+    bool cached = false;    // <md5>.png exists in the thumbnail cache
+    bool stale = false;     // ...but it was made from an older version of the file
+
+    QString cachedPath(const QString &cacheFolder) const {
+        return cacheFolder + "/" + QString::fromLatin1(md5.toHex()) + ".png";
+    }
+};
+
+// Order entries are listed in: depth-first per directory, files before subfolders,
+// names sorted. Used to find where a newly created wallpaper goes in the grid.
+bool libraryOrderLess(const QString &a, const QString &b);
+
+// Persistent, versioned index of the wallpaper library.
+// The file is memory-mapped on startup and only directories whose mtime
+// changed since the last run are listed and hashed again, files in the
+// others aren't touched until checkFiles().
+class LibraryIndex {
+public:
+    explicit LibraryIndex(const QString &indexPath = LIBRARY_INDEX());
+
+    // Bring the index up to date with mainFolder, entries are grouped per directory.
+    // chunk, if given, gets them in the same order a few directories at a time
+    using EntriesFn = std::function<void(const QList<LibraryEntry> &entries)>;
+    QList<LibraryEntry> refresh(const QString &mainFolder, const QString &cacheFolder, const ThumbnailCacheSet &cache,
+                                const EntriesFn &chunk = {});
+    QList<LibraryEntry> entries() const;
+
+    // Writing over a wallpaper keeps its dir's mtime, so files in the dirs the last
+    // refresh() reused get their statx here, once the entries are out.
+    // Returns how many entries changed or went away.
+    int checkFiles(const ThumbnailCacheSet &cache);
+
+    bool save() const;
+    bool isDirty() const { return m_dirty; }
+
+    // Stats of the last refresh
+    int reusedDirs() const { return m_reusedDirs; }
+    int rescannedDirs() const { return m_rescannedDirs; }
+
+    static QByteArray uriMd5(const QString &absoluteFilePath);
+
+private:
+    struct Dir {
+        QString path;
+        qint64 mtime = 0;
+        int parent = -1;
+        bool reused = false;    // taken from the old index, files not stat'ed yet
+        QList<LibraryEntry> files;
+    };
+
+    QString m_indexPath;
+    QString m_mainFolder;
+    QString m_cacheFolder;
+    QList<Dir> m_dirs;
+    int m_reusedDirs = 0;
+    int m_rescannedDirs = 0;
+    bool m_dirty = false;
+
+    void recheck(LibraryEntry &e, const ThumbnailCacheSet &cache, bool edited);
+};
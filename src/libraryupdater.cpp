@@ -0,0 +1,268 @@
+// libraryupdater.cpp
+#include "libraryupdater.h"
+#include "inotifywatcher.h"
+#include "libraryindex.h"
+#include "dirscanner.h"
+#include "thumbnailcacheset.h"
+#include "pngtext.h"
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QImageReader>
+#include <QDebug>
+#include <algorithm>
+#include <utility>
+
+// Quiet time before a burst is flushed, and the longest a burst may be held back
+static const int DEBOUNCE_MS = 150;
+static const int MAX_LATENCY_MS = 1000;
+
+LibraryUpdater::LibraryUpdater(const QString &cacheFolder, const QString &mainFolder, ThumbnailCacheSet *cache, QObject *parent)
+    : QObject(parent), m_cacheFolder(cacheFolder), m_cache(cache)
+{
+    m_watcher = new InotifyWatcher(mainFolder, this);
+    connect(m_watcher, &InotifyWatcher::fileCreated, this, &LibraryUpdater::onFileCreated);
+    connect(m_watcher, &InotifyWatcher::fileDeleted, this, &LibraryUpdater::onFileDeleted);
+    connect(m_watcher, &InotifyWatcher::fileRenamed, this, &LibraryUpdater::onFileRenamed);
+    connect(m_watcher, &InotifyWatcher::fileChanged, this, &LibraryUpdater::onFileChanged);
+    connect(m_watcher, &InotifyWatcher::directoryRenamed, this, &LibraryUpdater::onDirectoryRenamed);
+    connect(m_watcher, &InotifyWatcher::directoryRescanNeeded, this, &LibraryUpdater::onDirectoryRescanNeeded);
+    // a removed directory is just a rescan that finds nothing
+    connect(m_watcher, &InotifyWatcher::directoryRemoved, this, &LibraryUpdater::onDirectoryRescanNeeded);
+
+    // a thumbnail another tool just finished brings its wallpaper into the grid
+    connect(m_cache, &ThumbnailCacheSet::thumbnailAdded, this, &LibraryUpdater::onThumbnailAdded);
+
+    m_debounce.setSingleShot(true);
+    connect(&m_debounce, &QTimer::timeout, this, &LibraryUpdater::flush);
+}
+
+void LibraryUpdater::setUncached(const QList<ThumbnailJob> &uncached) {
+    m_uncached.clear();
+    m_uncached.reserve(uncached.size());
+    for (const ThumbnailJob &job : uncached) m_uncached.insert(job.md5, job.filePath);
+}
+
+void LibraryUpdater::onThumbnailAdded(const QByteArray &md5) {
+    const QString filePath = m_uncached.take(md5);
+    if (filePath.isEmpty()) return;
+    m_created.insert(filePath);
+    schedule();
+}
+
+void LibraryUpdater::schedule() {
+    if (!m_pendingSince.isValid()) m_pendingSince.start();
+
+    // keep pushing the flush back while events keep coming, but not forever
+    int wait = qMin<qint64>(DEBOUNCE_MS, qMax<qint64>(0, MAX_LATENCY_MS - m_pendingSince.elapsed()));
+    m_debounce.start(wait);
+}
+
+void LibraryUpdater::onFileCreated(const QString &path) {
+    // deleted and recreated within one burst: treat it as changed, drop + add again
+    m_created.insert(path);
+    schedule();
+}
+
+void LibraryUpdater::onFileDeleted(const QString &path) {
+    // created and deleted within one burst never reaches the grid
+    if (!m_created.remove(path)) m_deleted.insert(path);
+    schedule();
+}
+
+void LibraryUpdater::onFileRenamed(const QString &from, const QString &to) {
+    m_renamed.append({from, to});
+    schedule();
+}
+
+void LibraryUpdater::onFileChanged(const QString &path) {
+    // edited in place: same slot, but its thumbnail may now show the old picture
+    if (!DirScanner::isImageName(path)) return;
+    const QFileInfo fi(path);
+    const QByteArray md5 = LibraryIndex::uriMd5(fi.absoluteFilePath());
+    if (!m_cache->contains(md5)) return;
+
+    const QString cachedPath = m_cacheFolder + "/" + QString::fromLatin1(md5.toHex()) + ".png";
+    const qint64 mtime = fi.lastModified().toMSecsSinceEpoch() * 1000000LL;
+    if (!isThumbnailStale(cachedPath, mtime, fi.size())) return;
+
+    m_missing.append({cachedPath, fi.dir().dirName(), fi.absoluteFilePath(), QSize(), -1, md5});
+    schedule();
+}
+
+void LibraryUpdater::onDirectoryRenamed(const QString &from, const QString &to) {
+    m_renamedDirs.append({from, to});
+    schedule();
+}
+
+void LibraryUpdater::onDirectoryRescanNeeded(const QString &path) {
+    m_rescan.insert(path);
+    schedule();
+}
+
+bool LibraryUpdater::addIfCached(LibraryChanges &changes, const QString &filePath, const QString &folder) {
+    const QByteArray md5 = LibraryIndex::uriMd5(filePath);
+    const QString cachedPath = m_cacheFolder + "/" + QString::fromLatin1(md5.toHex()) + ".png";
+    if (!m_cache->contains(md5)) {
+        m_uncached.insert(md5, filePath); // picked up once its thumbnail is written
+        m_missing.append({cachedPath, folder, filePath, QSize(), -1, md5});
+        return false;
+    }
+
+    const QFileInfo fi(filePath);
+    const qint64 mtime = fi.lastModified().toMSecsSinceEpoch() * 1000000LL;
+    changes.added.append({cachedPath, folder, filePath, QImageReader(cachedPath).size(), -1, md5, mtime});
+
+    // a thumbnail left over from an older file of the same name
+    if (isThumbnailStale(cachedPath, mtime, fi.size()))
+        m_missing.append({cachedPath, folder, filePath, QSize(), -1, md5});
+    return true;
+}
+
+void LibraryUpdater::flush() {
+    m_pendingSince.invalidate();
+
+    LibraryChanges changes;
+    changes.removed = QStringList(m_deleted.begin(), m_deleted.end());
+    changes.renamedDirs = m_renamedDirs;
+
+    // the source may never have been in the grid (x.jpg.part -> x.jpg, editors
+    // saving through a temp file) and the new name has its own thumbnail, so a
+    // rename is a delete of the old name plus a create of the new one. The move
+    // is only kept so a slot that exists holds on to its pixmap
+    for (const auto &r : std::as_const(m_renamed)) {
+        m_created.remove(r.first);
+        m_uncached.remove(LibraryIndex::uriMd5(r.first));
+
+        const QFileInfo fi(r.second);
+        if (!DirScanner::isImageName(r.second) || !fi.isFile()) {
+            changes.removed.append(r.first);
+            continue;
+        }
+        m_created.remove(r.second);
+        if (addIfCached(changes, fi.absoluteFilePath(), fi.dir().dirName())) changes.renamed.append(r);
+        else changes.removed.append(r.first);   // back once its thumbnail is written
+    }
+
+    // every md5 below a moved folder changes with it, so its files go the same way
+    // as single renames. Whatever isn't moved along is dropped with the old subtree
+    for (const auto &d : std::as_const(m_renamedDirs)) {
+        for (const ScannedDir &sd : DirScanner().scan(d.second)) {
+            const QString folder = QDir(sd.path).dirName();
+            for (const ScannedFile &f : sd.files) {
+                const QString to = sd.path + "/" + f.name;
+                const QString from = d.first + to.mid(d.second.size());
+                m_created.remove(to);
+                m_uncached.remove(LibraryIndex::uriMd5(from));
+                if (addIfCached(changes, to, folder)) changes.renamed.append({from, to});
+            }
+        }
+    }
+
+    // nested subtrees are covered by their parent's listing
+    QStringList rescan(m_rescan.begin(), m_rescan.end());
+    std::sort(rescan.begin(), rescan.end());
+    for (const QString &dir : std::as_const(rescan)) {
+        if (!changes.rescanned.isEmpty() && dir.startsWith(changes.rescanned.last() + "/")) continue;
+        changes.rescanned.append(dir);
+
+        for (const ScannedDir &sd : DirScanner().scan(dir)) {
+            const QString folder = QDir(sd.path).dirName();
+            for (const ScannedFile &f : sd.files) addIfCached(changes, sd.path + "/" + f.name, folder);
+        }
+    }
+
+    for (const QString &path : std::as_const(m_created)) {
+        if (!DirScanner::isImageName(path)) continue;
+        QFileInfo fi(path);
+        if (fi.isFile()) addIfCached(changes, fi.absoluteFilePath(), fi.dir().dirName());
+    }
+
+    m_created.clear();
+    m_deleted.clear();
+    m_renamed.clear();
+    m_renamedDirs.clear();
+    m_rescan.clear();
+
+    if (!m_missing.isEmpty()) emit thumbnailsMissing(std::exchange(m_missing, {}));
+    if (changes.isEmpty()) return;
+    qDebug() << "Library changes:" << changes.added.size() << "added," << changes.removed.size()
+             << "removed," << changes.renamed.size() << "renamed," << changes.renamedDirs.size() << "folders moved,"
+             << changes.rescanned.size() << "rescanned";
+    emit changesReady(changes);
+}
+
+bool applyLibraryChanges(QList<CachedImage> &images, const LibraryChanges &changes) {
+    if (changes.isEmpty()) return false;
+
+    const QSet<QString> removed(changes.removed.begin(), changes.removed.end());
+    QHash<QString, QString> renamed;
+    QSet<QString> renameTargets;
+    for (const auto &r : changes.renamed) {
+        renamed.insert(r.first, r.second);
+        renameTargets.insert(r.second);
+    }
+
+    // entries under a rescanned subtree only survive if the listing found them again
+    QSet<QString> listed;
+    for (const ThumbnailJob &job : changes.added) listed.insert(job.filePath);
+    auto underRescan = [&](const QString &path) {
+        for (const QString &dir : changes.rescanned)
+            if (path.startsWith(dir + "/")) return true;
+        return false;
+    };
+    auto underRenamedDir = [&](const QString &path) {
+        for (const auto &d : changes.renamedDirs)
+            if (path.startsWith(d.first + "/")) return true;
+        return false;
+    };
+
+    bool changed = false;
+    QList<CachedImage> kept;
+    QList<CachedImage> inserts; // renamed + added, merged back in library order below
+    QSet<QString> present;
+    kept.reserve(images.size());
+
+    for (CachedImage &img : images) {
+        // renamed onto: the old entry there is replaced by the one moving in
+        const bool overwritten = renameTargets.contains(img.filePath) && !renamed.contains(img.filePath);
+        const QString newPath = renamed.value(img.filePath);
+        if (overwritten || removed.contains(img.filePath) ||
+            (!changes.rescanned.isEmpty() && !listed.contains(img.filePath) && underRescan(img.filePath)) ||
+            (newPath.isEmpty() && !changes.renamedDirs.isEmpty() && underRenamedDir(img.filePath))) {
+            changed = true;
+            continue;
+        }
+
+        if (!newPath.isEmpty()) {
+            // same file, same pixels, and the new name has a thumbnail: keep the decoded pixmap and just move it
+            img.filePath = newPath;
+            img.folder = QFileInfo(newPath).dir().dirName();
+            inserts.append(img);
+            present.insert(img.filePath);
+            changed = true;
+            continue;
+        }
+        kept.append(img);
+        present.insert(img.filePath);
+    }
+
+    for (const ThumbnailJob &job : changes.added) {
+        if (present.contains(job.filePath)) continue;
+        inserts.append({QPixmap(), job.folder, job.filePath, job.size, job.mtime});
+        present.insert(job.filePath);
+        changed = true;
+    }
+
+    if (!changed) return false;
+
+    auto less = [](const CachedImage &a, const CachedImage &b) { return libraryOrderLess(a.filePath, b.filePath); };
+    std::sort(inserts.begin(), inserts.end(), less);
+
+    images.clear();
+    images.reserve(kept.size() + inserts.size());
+    std::merge(kept.begin(), kept.end(), inserts.begin(), inserts.end(), std::back_inserter(images), less);
+    return true;
+}
@@ -0,0 +1,78 @@
+// libraryupdater.h
+#pragma once
+#include <QObject>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QTimer>
+#include "cachedimage.h"
+#include "thumbnailloader.h"
+
+class InotifyWatcher;
+class ThumbnailCacheSet;
+
+// One coalesced batch of library changes
+struct LibraryChanges {
+    QList<ThumbnailJob> added;                  // only wallpapers that have a cached thumbnail
+    QStringList removed;
+    QList<QPair<QString, QString>> renamed;     // from, to
+    QList<QPair<QString, QString>> renamedDirs; // from, to, nothing is left below from, the files that moved are in renamed
+    QStringList rescanned;                      // subtrees listed again, `added` is authoritative for them
+
+    bool isEmpty() const {
+        return added.isEmpty() && removed.isEmpty() && renamed.isEmpty() &&
+               renamedDirs.isEmpty() && rescanned.isEmpty();
+    }
+};
+
+// Turns inotify events from the wallpaper folder into debounced, batched
+// insert/remove/rename updates, so a burst of copies becomes one model update
+class LibraryUpdater : public QObject {
+    Q_OBJECT
+public:
+    LibraryUpdater(const QString &cacheFolder, const QString &mainFolder, ThumbnailCacheSet *cache, QObject *parent = nullptr);
+
+    // Wallpapers without a thumbnail yet, they are added once one shows up in the cache
+    void setUncached(const QList<ThumbnailJob> &uncached);
+
+signals:
+    void changesReady(const LibraryChanges &changes);
+    // New wallpapers that have no thumbnail to show yet
+    void thumbnailsMissing(const QList<ThumbnailJob> &jobs);
+
+private slots:
+    void onFileCreated(const QString &path);
+    void onFileDeleted(const QString &path);
+    void onFileRenamed(const QString &from, const QString &to);
+    void onFileChanged(const QString &path);
+    void onDirectoryRenamed(const QString &from, const QString &to);
+    void onDirectoryRescanNeeded(const QString &path);
+    void flush();
+
+private:
+    QString m_cacheFolder;
+    InotifyWatcher *m_watcher;
+    ThumbnailCacheSet *m_cache;
+    QHash<QByteArray, QString> m_uncached;  // md5 -> wallpaper
+    QList<ThumbnailJob> m_missing;          // found uncached in this flush
+
+    QTimer m_debounce;
+    QElapsedTimer m_pendingSince;   // first event of the current burst
+    QSet<QString> m_created;
+    QSet<QString> m_deleted;
+    QList<QPair<QString, QString>> m_renamed;
+    QList<QPair<QString, QString>> m_renamedDirs;
+    QSet<QString> m_rescan;
+
+    void schedule();
+    bool addIfCached(LibraryChanges &changes, const QString &filePath, const QString &folder);
+    void onThumbnailAdded(const QByteArray &md5);
+};
+
+// Apply a batch to a grid's list in place, keeping library order.
+// Returns false if nothing in the list changed.
+bool applyLibraryChanges(QList<CachedImage> &images, const LibraryChanges &changes);
@@ -10,9 +10,9 @@
 #include <QSlider>
 #include <QDebug>
 #include <QCryptographicHash>
-#include <QFileSystemWatcher>
 #include <QScrollBar>
 #include <QTimer>
+#include <QElapsedTimer>
 #include <QMouseEvent>
 #include <QSettings>
 #include <QProcess>
@@ -22,6 +22,7 @@
 #include <QJsonObject>
 
 #include <QDir>
+#include <QFileInfo>
 #include <QString>
 #include <QFile>
 #include <QTextStream> 
@@ -29,390 +30,198 @@
 
 #include "reload.h"
 #include "paths.h"
-#include "inotifywatcher.h"
+#include "thumbnaillibrary.h"
+#include "thumbnailgrid.h"
+#include "thumblayout.h"
+#include "animationdriver.h"
+#include "startupmetrics.h"
+#include "pngtext.h"
+#include "hyprsocket.h"
+#include "wallpaperapplier.h"
+#include "monitorregistry.h"
 
 #include "gpu_renderer.h"
+#include "gpu_surface.h"
 #include "cachedimage.h"
 
 
 
 int THUMB_HEIGHT = 200; 
-const int SPACING = 10;
-const int FOLDER_GAP = 30;
 const int WINDOW_PADDING = 20;
+const QString ALL_MONITORS = "All monitors";   // combo entry for applying to every monitor at once
 
 
-class QHppQ : public QWidget {
+// QPainter grid for --cpu, everything it does is shared with the GPU one
+class QHppQ : public ThumbnailGrid {
     Q_OBJECT
 public:
-    QString currentMonitor() const { return m_currentMonitor; }
-    void setCurrentMonitor(const QString &monitor) { m_currentMonitor = monitor; }
-
-    QHppQ(const QString &cacheFolder, const QString &mainFolder, QWidget *parent = nullptr)
-        : QWidget(parent), m_cacheFolder(cacheFolder), m_mainFolder(mainFolder)
-    {
-        setAttribute(Qt::WA_TranslucentBackground);
-        setMouseTracking(true);
-
-        // real-time inotify-based watcher
-        InotifyWatcher *iw = new InotifyWatcher(mainFolder, this);
-
-        connect(iw, &InotifyWatcher::fileCreated, this, [&](const QString &path){
-            qDebug() << "Created:" << path;
-            loadFilteredPixmaps(m_cacheFolder, m_mainFolder);
-            update();
-        });
-
-        connect(iw, &InotifyWatcher::fileDeleted, this, [&](const QString &path){
-            qDebug() << "Deleted:" << path;
-            loadFilteredPixmaps(m_cacheFolder, m_mainFolder);
-            update();
-        });
-
-        // initial load
-        loadFilteredPixmaps(m_cacheFolder, m_mainFolder);
-    }
-
-    int getThumbnailIndexAtY(int y) {
-        int rowHeight = THUMB_HEIGHT;
-        int currentY = 0;
-        int rowWidth = 0;
-        QString currentFolder;
-        QList<CachedImage> rowPixmaps;
-        
-
-        for (int i = 0; i < m_pixmaps.size(); ++i) {
-            const CachedImage &cimg = m_pixmaps[i];
-            int w = cimg.pix.width() * rowHeight / cimg.pix.height();
-
-            if (!currentFolder.isEmpty() && currentFolder != cimg.folder) {
-                currentY += rowHeight + FOLDER_GAP;
-                rowPixmaps.clear();
-                rowWidth = 0;
-            }
-            currentFolder = cimg.folder;
-
-            if (rowWidth + w + (rowPixmaps.size() > 0 ? SPACING : 0) > width()) {
-                currentY += rowHeight + SPACING;
-                rowPixmaps.clear();
-                rowWidth = 0;
-            }
-
-            if (y >= currentY && y < currentY + rowHeight)
-                return i;
-
-            rowPixmaps.append(cimg);
-            rowWidth += w + (rowPixmaps.size() > 0 ? SPACING : 0);
-        }
-        return m_pixmaps.size() - 1;
-    }
-
-    int getYPositionOfThumbnail(int index) {
-        int rowHeight = THUMB_HEIGHT;
-        int currentY = 0;
-        int rowWidth = 0;
-        QString currentFolder;
-        QList<CachedImage> rowPixmaps;
-
-        for (int i = 0; i <= index && i < m_pixmaps.size(); ++i) {
-            const CachedImage &cimg = m_pixmaps[i];
-            int w = cimg.pix.width() * rowHeight / cimg.pix.height();
-
-            if (!currentFolder.isEmpty() && currentFolder != cimg.folder) {
-                currentY += rowHeight + FOLDER_GAP;
-                rowPixmaps.clear();
-                rowWidth = 0;
-            }
-            currentFolder = cimg.folder;
-
-            if (rowWidth + w + (rowPixmaps.size() > 0 ? SPACING : 0) > width()) {
-                currentY += rowHeight + SPACING;
-                rowPixmaps.clear();
-                rowWidth = 0;
-            }
-
-            rowPixmaps.append(cimg);
-            rowWidth += w + (rowPixmaps.size() > 0 ? SPACING : 0);
-
-            if (i == index) return currentY;
-        }
-        return 0;
-    }
-
-
-protected:
-    void paintEvent(QPaintEvent*) override {
-        QPainter painter(this);
-        painter.setRenderHint(QPainter::SmoothPixmapTransform);
-
-        int y = 0;
-        int rowHeight = THUMB_HEIGHT;
-        QString currentFolder;
-        QList<CachedImage> rowPixmaps;
-        int rowWidth = 0;
-
-        m_thumbnailRects.clear(); // clear previous positions
-
-        auto drawRow = [&](QList<CachedImage> &rowPixmaps, int y, int rowWidth) {
-            int x = (width() - rowWidth) / 2;
-            for (int i = 0; i < rowPixmaps.size(); ++i) {
-                const CachedImage &rpix = rowPixmaps[i];
-                int rw = rpix.pix.width() * rowHeight / rpix.pix.height();
-                QRect thumbRect(x, y, rw, rowHeight);
-
-                // Hover flash: subtle pulsing white overlay
-                if (m_hovering && m_hoveredImage.filePath == rpix.filePath) {
-                    int hoverAlpha = 40 + int(15 * std::sin(QDateTime::currentMSecsSinceEpoch() / 100.0));
-                    QPixmap bright = rpix.pix;
-                    QPainter tmp(&bright);
-                    tmp.fillRect(bright.rect(), QColor(255, 255, 255, hoverAlpha));
-                    tmp.end();
-                    painter.drawPixmap(thumbRect, bright);
-                } else {
-                    painter.setOpacity(0.85);
-                    painter.drawPixmap(thumbRect, rpix.pix);
-                    painter.setOpacity(1.0);
-                }
-
-                // Click flash: temporary white overlay
-                if (m_clickedIndex >= 0 &&
-                    m_clickedIndex < m_pixmaps.size() &&
-                    m_pixmaps[m_clickedIndex].filePath == rpix.filePath &&
-                    m_clickFlashProgress > 0.0)
-                {
-                    painter.fillRect(thumbRect, QColor(255, 255, 255, int(100 * m_clickFlashProgress)));
-                }
-
-                m_thumbnailRects.append(thumbRect);
-                x += rw + SPACING;
-            }
-        };
-
-        for (const CachedImage &cimg : m_pixmaps) {
-            int w = cimg.pix.width() * rowHeight / cimg.pix.height();
-
-            // Folder gap
-            if (!currentFolder.isEmpty() && currentFolder != cimg.folder) {
-                drawRow(rowPixmaps, y, rowWidth);
-                y += rowHeight + FOLDER_GAP;
-                rowPixmaps.clear();
-                rowWidth = 0;
-            }
-            currentFolder = cimg.folder;
-
-            // Row wrap
-            if (rowWidth + w + (rowPixmaps.size() > 0 ? SPACING : 0) > width()) {
-                drawRow(rowPixmaps, y, rowWidth);
-                y += rowHeight + SPACING;
-                rowPixmaps.clear();
-                rowWidth = 0;
-            }
-
-            rowPixmaps.append(cimg);
-            rowWidth += w + (rowPixmaps.size() > 1 ? SPACING : 0);
-        }
-
-        // Last row
-        if (!rowPixmaps.isEmpty()) {
-            drawRow(rowPixmaps, y, rowWidth);
-            y += rowHeight + SPACING;
-        }
-
-        setMinimumHeight(y);
-
-        // Keep repainting if hover or click flash is active
-        if (m_hovering || (m_clickedIndex >= 0 && m_clickFlashProgress > 0.0)) {
-            update();
-        }
-    }
-
-    void resizeEvent(QResizeEvent* event) override {
-        QWidget::resizeEvent(event);
-        update();
-    }
-
-    void mousePressEvent(QMouseEvent *event) override {
-        m_clickedIndex = -1;
-
-        for (int i = 0; i < m_pixmaps.size(); ++i) {
-            if (m_thumbnailRects[i].contains(event->pos())) {
-                m_clickedIndex = i;
-                m_clickFlashProgress = 1.0; // full flash
-                QTimer::singleShot(150, this, [this]() {
-                    m_clickFlashProgress = 0.0; // fade out
-                    update();
-                });
-                update();
-                break;
-            }
-        }
-        if (m_clickedIndex >= 0 && m_clickedIndex < m_pixmaps.size()) {
-            // QString dir = m_pixmaps[m_clickedIndex].folder; // Fine name only
-            // QString dir = QFileInfo(m_pixmaps[m_clickedIndex].filePath).absolutePath();
-            // QString filePath = m_pixmaps[m_clickedIndex].filePath;
-            QString filePath = QFileInfo(m_pixmaps[m_clickedIndex].filePath).absoluteFilePath();
-            QString monitor = m_currentMonitor; // now safe
-            recordClick(monitor, filePath);
-            updateHyprpaperWallpaper(monitor, filePath);
-            // updateHyprpaperConf(); // Not Yet
-        }
-        QWidget::mousePressEvent(event);
-    }
-    void mouseMoveEvent(QMouseEvent *event) override {
-        m_hovering = false;
-
-        for (int i = 0; i < m_pixmaps.size(); ++i) {
-            if (m_thumbnailRects[i].contains(event->pos())) {
-                m_hovering = true;
-                m_hoveredImage = m_pixmaps[i];
-                m_hoveredRect = m_thumbnailRects[i];
-                startHoverTimer();   // start pulsing
-                break;
-            }
-        }
-
-        if (!m_hovering) stopHoverTimer();  // stop pulsing if no hover
-        update();
-        QWidget::mouseMoveEvent(event);
-    }
-
-    
-
-
-private:
-    QList<CachedImage> m_pixmaps;
-    QFileSystemWatcher *watcher;
-    QString m_cacheFolder;
-    QString m_mainFolder;
-    QTimer hoverTimer;
-    QString m_currentMonitor;
-
-    // Hover tracking
-    bool m_hovering = false;
-    CachedImage m_hoveredImage;
-    QRect m_hoveredRect;
-    QList<QRect> m_thumbnailRects; // positions of all thumbnails
-
-    int m_hoveringIndex = -1;
-    int m_clickedIndex = -1;
-    qreal m_clickFlashProgress = 0.0;
-
-    void startHoverTimer() {
-        if (!hoverTimer.isActive()) {
-            connect(&hoverTimer, &QTimer::timeout, this, [=](){ update(); });
-            hoverTimer.start(90); // ~30ms for smooth pulsing, but lets do 90
-        }
-    }
-
-    void stopHoverTimer() {
-        if (hoverTimer.isActive()) hoverTimer.stop();
-    }
-
-    void addWatchRecursive(const QString &path) {
-        QDir dir(path);
-
-        // Add current dir if not already watched
-        if (!watcher->directories().contains(path))
-            watcher->addPath(path);
-
-        // Recurse into subdirs
-        for (const QString &subdir : dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot)) {
-            addWatchRecursive(dir.absoluteFilePath(subdir));
-        }
-    }
-
-    void onDirectoryChanged(const QString &path) {
-        qDebug() << "Directory changed:" << path;
-
-        // Reset watcher list
-        watcher->removePaths(watcher->directories());
-        addWatchRecursive(m_mainFolder);
-
-        // Reload thumbnails
-        loadFilteredPixmaps(m_cacheFolder, m_mainFolder);
-        update();
-    }
-
-    void loadFilteredPixmaps(const QString &cacheFolder, const QString &mainFolder) {
-        m_pixmaps.clear();
-        QDirIterator it(mainFolder, QDir::Files, QDirIterator::Subdirectories);
-        while (it.hasNext()) {
-            QString filePath = it.next();
-            QFileInfo fi(filePath);
-            QString folderName = fi.dir().dirName();
-
-            QByteArray uri = ("file://" + fi.absoluteFilePath()).toUtf8();
-            QString md5 = QCryptographicHash::hash(uri, QCryptographicHash::Md5).toHex();
-
-            QString cachedPath = cacheFolder + "/" + md5 + ".png";
-            if (QFile::exists(cachedPath)) {
-                QPixmap pix(cachedPath);
-                if (!pix.isNull()) m_pixmaps.append({pix, folderName, filePath});
-            }
-        }
-    }
+    using ThumbnailGrid::ThumbnailGrid;
 };
 
 
 int main(int argc, char *argv[]) {
+    startupClock().start();
  
-    // Step 0: parse CPU flag
+    // Step 0: parse flags
     bool cpuFlag = false;
+    bool softwareGl = false;
+    bool measureStartup = false; // print time to first visible thumbnail and quit
+    bool measureStaleCheck = false; // time the png header check against full decodes and quit
+    bool measureIpc = false;     // time socket round trips against hyprctl and quit
     for (int i = 1; i < argc; ++i) {
         if (QString(argv[i]) == "--cpu") {
             cpuFlag = true;
             QCoreApplication::setAttribute(Qt::AA_UseSoftwareOpenGL);
-            break;
+        } else if (QString(argv[i]) == "--software-gl") {
+            // GL renderer on Mesa's llvmpipe, for machines without a usable GPU
+            softwareGl = true;
+            qputenv("LIBGL_ALWAYS_SOFTWARE", "1");
+            QCoreApplication::setAttribute(Qt::AA_UseSoftwareOpenGL);
+        } else if (QString(argv[i]) == "--measure-stale-check") {
+            measureStaleCheck = true;
+        } else if (QString(argv[i]) == "--measure-ipc") {
+            measureIpc = true;
+        } else if (QString(argv[i]) == "--measure-startup") {
+            measureStartup = true;
         }
     }
 
 if(cpuFlag)
     qDebug() << "CPU render mode enabled";
+else if(softwareGl)
+    qDebug() << "OpenGL render mode enabled (software)";
 else
     qDebug() << "GPU accelerated render mode enabled";
 
 
     QApplication app(argc, argv);
     QSettings settings("QtHyprpaper", "QtHyprpaperGUI");
+    AnimationDriver::setFrameCap(settings.value("animationFpsCap", 60).toInt());
+    ThumbnailResidency::setDefaultBudget(settings.value("thumbnailBudgetMB", 512).toLongLong() * 1024 * 1024);
+    WallpaperApplier::setSpeculation(settings.value("speculativePreload", false).toBool(),
+                                     settings.value("speculativeDwellMs", 350).toInt(),
+                                     settings.value("speculativeMaxImages", 3).toInt(),
+                                     settings.value("speculativeBudgetMB", 1024).toLongLong() * 1024 * 1024);
 
     app.setApplicationName("QtHyprpaperGUI"); 
     app.setApplicationDisplayName("Qt Hyprpaper GUI"); 
 
-    QObject::connect(&app, &QApplication::aboutToQuit, []() {
-        updateHyprpaperConf(); // save clicks to hyprpaper.conf
-    });
 
-    loadLastClickedWallpapers();
-    QStringList monitors = getMonitorList();
-
-    // Step 1: preload thumbnails
-    QList<CachedImage> m_pixmaps;
-    QDirIterator it(MAIN_FOLDER(), QDir::Files, QDirIterator::Subdirectories);
-    while (it.hasNext()) {
-        QString filePath = it.next();
-        QFileInfo fi(filePath);
-        QString folderName = fi.dir().dirName();
-        QByteArray uri = ("file://" + fi.absoluteFilePath()).toUtf8();
-        QString md5 = QCryptographicHash::hash(uri, QCryptographicHash::Md5).toHex();
-        QString cachedPath = CACHE_FOLDER() + "/" + md5 + ".png";
-        if (QFile::exists(cachedPath)) {
-            QPixmap pix(cachedPath);
-            if (!pix.isNull()) m_pixmaps.append({pix, folderName, filePath});
+    if (measureIpc) {
+        // same request both ways, works against tools/hypr-standin.py too
+        const int n = 100;
+        QElapsedTimer t;
+        t.start();
+        int ok = 0;
+        for (int i = 0; i < n; ++i) {
+            QByteArray reply;
+            ok += HyprSocket::request(HyprSocket::Hyprland, "j/monitors", reply);
         }
+        qInfo() << "Socket:" << t.nsecsElapsed() / n / 1000.0 << "us per request," << ok << "of" << n << "answered"
+                << "(" << HyprSocket::socketDir() << ")";
+
+        t.restart();
+        for (int i = 0; i < 10; ++i) {
+            QProcess p;
+            p.start("hyprctl", {"monitors", "-j"});
+            p.waitForFinished();
+        }
+        qInfo() << "hyprctl:" << t.nsecsElapsed() / 10 / 1000.0 << "us per request";
+        return 0;
     }
 
-    // Step 2: create renderer widget
-    QWidget *grid = nullptr;
-    if (cpuFlag) {
-        grid = new QHppQ(CACHE_FOLDER(), MAIN_FOLDER());
-    } else {
-        auto gpuGrid = new QHppQ_GPU(CACHE_FOLDER(), MAIN_FOLDER());
-        gpuGrid->loadPixmaps(m_pixmaps);
-        grid = gpuGrid;
+    if (measureStaleCheck) {
+        // header-only tEXt read vs. what a full QImage load of the same thumbnails costs
+        ThumbnailCacheSet cache(CACHE_FOLDER());
+        const QList<ThumbnailJob> jobs = ThumbnailLoader::scanLibrary(CACHE_FOLDER(), MAIN_FOLDER(), cache);
+        const int n = qMin<int>(jobs.size(), 2000);
+        if (n == 0) {
+            qInfo() << "No cached thumbnails to measure";
+            return 0;
+        }
+
+        QElapsedTimer t;
+        t.start();
+        int stale = 0;
+        for (int i = 0; i < n; ++i) stale += isThumbnailStale(jobs[i].cachedPath, jobs[i].mtime, 0);
+        const qint64 headerNs = t.nsecsElapsed();
+
+        t.restart();
+        qint64 pixels = 0;
+        for (int i = 0; i < n; ++i) pixels += QImage(jobs[i].cachedPath).sizeInBytes();
+        const qint64 decodeNs = t.nsecsElapsed();
+
+        qInfo() << "Stale check of" << n << "thumbnails:" << headerNs / n / 1000.0 << "us each," << stale << "stale";
+        qInfo() << "Full QImage load:" << decodeNs / n / 1000.0 << "us each," << (pixels >> 20) << "MiB decoded,"
+                << double(decodeNs) / qMax<qint64>(1, headerNs) << "x slower";
+        return 0;
     }
 
-    // Step 3: Scroll area setup
+    loadLastClickedWallpapers();
+
+    // monitor list kept live from Hyprland's events, no asking again at quit
+    MonitorRegistry *monitorRegistry = new MonitorRegistry(&app);
+    QObject::connect(&app, &QApplication::aboutToQuit, [measureStartup, monitorRegistry]() {
+        if (!measureStartup) updateHyprpaperConf(monitorRegistry->monitors()); // save clicks to hyprpaper.conf
+    });
+
+    // Step 1: one library for whichever renderer, thumbnails stream in after the window is up
+    ThumbnailLibrary *library = new ThumbnailLibrary(CACHE_FOLDER(), MAIN_FOLDER(), &app);
+    ThumbnailGrid *grid = nullptr;
+    auto onFirstThumbnail = [&](qint64 ms){
+        qInfo() << "Time to first visible thumbnail:" << ms << "ms";
+        if (measureStartup) app.quit();
+    };
+    // clicks only queue the change, hyprpaper is talked to in the background
+    WallpaperApplier *applier = new WallpaperApplier(&app);
+    QObject::connect(&app, &QApplication::aboutToQuit, applier, &WallpaperApplier::logSpeculationStats);
+
+    // "All monitors" in the combo box sends one wallpaper everywhere, shift-click
+    // spreads the clicked one and those after it over the monitors in order.
+    // Either way all monitors switch together as one batch
+    auto applyToAll = [applier, monitorRegistry](const QStringList &filePaths){
+        const QStringList &monitors = monitorRegistry->monitors();
+        if (monitors.isEmpty() || filePaths.isEmpty()) return;
+        QHash<QString, QString> batch;
+        for (int i = 0; i < monitors.size(); ++i) {
+            const QString &filePath = filePaths[i % filePaths.size()];
+            recordClick(monitors[i], filePath);
+            batch.insert(monitors[i], filePath);
+        }
+        applier->applyBatch(batch);
+    };
+    auto onChosen = [applier, applyToAll](const QString &monitor, const QString &filePath){
+        if (monitor == ALL_MONITORS) {
+            applyToAll({filePath});
+            return;
+        }
+        recordClick(monitor, filePath);
+        applier->apply(monitor, filePath);
+    };
+    auto onSpread = [library, monitorRegistry, applyToAll](int index){
+        const ThumbnailModel &model = library->model();
+        QStringList filePaths;
+        for (int i = index; i < model.size() && filePaths.size() < monitorRegistry->monitors().size(); ++i)
+            filePaths.append(QFileInfo(model.filePath(i)).absoluteFilePath());
+        applyToAll(filePaths);
+    };
+
+    if (cpuFlag) grid = new QHppQ(library);
+    else grid = new QHppQ_GPU(library);
+    QObject::connect(grid, &ThumbnailGrid::firstThumbnailVisible, onFirstThumbnail);
+    QObject::connect(grid, &ThumbnailGrid::wallpaperChosen, applier, onChosen);
+    QObject::connect(grid, &ThumbnailGrid::wallpaperSpreadChosen, applier, onSpread);
+    QObject::connect(grid, &ThumbnailGrid::wallpaperHovered, applier, &WallpaperApplier::hovered);
+
+    // Step 2: Scroll area setup
     QScrollArea *scroll = new QScrollArea;
+    if (!cpuFlag) {
+        // GL viewport draws the grid, has to be in place before setWidget()
+        auto surface = new GpuSurface;
+        scroll->setViewport(surface);
+        static_cast<QHppQ_GPU*>(grid)->setSurface(surface);
+        QObject::connect(scroll->verticalScrollBar(), &QScrollBar::valueChanged, surface, [surface](){ surface->update(); });
+    }
     scroll->setWidget(grid);
     scroll->setWidgetResizable(true);
     scroll->setFrameShape(QFrame::NoFrame);
@@ -429,7 +238,7 @@ else
         "QScrollBar::add-line, QScrollBar::sub-line { width: 0; }"
     );
 
-    // Step 4: main window
+    // Step 3: main window
     QWidget window;
     window.setAttribute(Qt::WA_TranslucentBackground);
     window.setWindowFlag(Qt::FramelessWindowHint);
@@ -438,7 +247,7 @@ else
     mainLayout->setContentsMargins(WINDOW_PADDING, WINDOW_PADDING, WINDOW_PADDING, WINDOW_PADDING);
     mainLayout->addWidget(scroll);
 
-    // Step 5: bottom controls
+    // Step 4: bottom controls
     QHBoxLayout *controlsLayout = new QHBoxLayout();
     controlsLayout->setContentsMargins(5,5,5,5);
 
@@ -456,36 +265,74 @@ else
     QObject::connect(zoomSlider, &QSlider::valueChanged, [&](int value){
         THUMB_HEIGHT = value;
         grid->update();
+        if (!cpuFlag) scroll->viewport()->update();
         settings.setValue("zoom", value);
     });
 
     // Monitor ComboBox
     QComboBox *combo = new QComboBox();
-    for (const QString &m : monitors) combo->addItem(m);
+    combo->addItem(ALL_MONITORS);
+    for (const QString &m : monitorRegistry->monitors()) combo->addItem(m);
     combo->setFixedWidth(100);
 
-    int savedIndex = settings.value("comboIndex", -1).toInt();
-    if (savedIndex >= 0 && savedIndex < combo->count())
+    // by name, monitors come and go so their index isn't stable. Older versions
+    // kept the index into a list without "All monitors", moved over once
+    if (!settings.contains("comboMonitor") && settings.contains("comboIndex")) {
+        const int oldIndex = settings.value("comboIndex").toInt() + 1;
+        if (oldIndex > 0 && oldIndex < combo->count()) settings.setValue("comboMonitor", combo->itemText(oldIndex));
+        settings.remove("comboIndex");
+    }
+    int savedIndex = combo->findText(settings.value("comboMonitor").toString());
+    if (savedIndex >= 0)
         combo->setCurrentIndex(savedIndex);
-    else if (combo->count() > 0)
-        combo->setCurrentIndex(0);
+    else if (combo->count() > 1)
+        combo->setCurrentIndex(1); // first monitor
 
-    auto setMonitorLambda = [&](const QString &text){
-        if(cpuFlag) static_cast<QHppQ*>(grid)->setCurrentMonitor(text);
-        else static_cast<QHppQ_GPU*>(grid)->setCurrentMonitor(text);
-    };
+    auto setMonitorLambda = [&](const QString &text){ grid->setCurrentMonitor(text); };
     setMonitorLambda(combo->currentText());
     QObject::connect(combo, &QComboBox::currentTextChanged, setMonitorLambda);
-    QObject::connect(combo, QOverload<int>::of(&QComboBox::currentIndexChanged),
-                     [&](int index){ settings.setValue("comboIndex", index); });
+    QObject::connect(combo, &QComboBox::currentTextChanged,
+                     [&](const QString &text){ settings.setValue("comboMonitor", text); });
+
+    // hot-plugged monitors come and go in the list. Removing the selected one
+    // moves the selection to the first monitor left (not onto "All monitors"),
+    // currentTextChanged then retargets the grid
+    QObject::connect(monitorRegistry, &MonitorRegistry::monitorAdded, combo, [combo](const QString &name){
+        if (combo->findText(name) < 0) combo->addItem(name);
+    });
+    QObject::connect(monitorRegistry, &MonitorRegistry::monitorRemoved, combo, [combo](const QString &name){
+        const int index = combo->findText(name);
+        if (index < 0) return;
+        if (index == combo->currentIndex()) {
+            const int fallback = index == 1 ? 2 : 1;
+            if (fallback < combo->count()) combo->setCurrentIndex(fallback);
+        }
+        combo->removeItem(index);
+    });
 
     controlsLayout->addWidget(combo);
     mainLayout->addLayout(controlsLayout);
 
     window.setWindowTitle("Qt Hyprpaper GUI");
+
+    // apply feedback in the title (task bars and window switchers show it)
+    QObject::connect(applier, &WallpaperApplier::applyStarted, &window, [&window](const QString &monitor, const QString &filePath){
+        window.setWindowTitle(QString("Qt Hyprpaper GUI - %1: %2 ...").arg(monitor, QFileInfo(filePath).fileName()));
+    });
+    QObject::connect(applier, &WallpaperApplier::applied, &window, [&window](const QString &monitor, const QString &filePath){
+        window.setWindowTitle(QString("Qt Hyprpaper GUI - %1: %2").arg(monitor, QFileInfo(filePath).fileName()));
+    });
+    QObject::connect(applier, &WallpaperApplier::applyFailed, &window, [&window](const QString &monitor, const QString &, const QString &error){
+        window.setWindowTitle(QString("Qt Hyprpaper GUI - %1 failed: %2").arg(monitor, error));
+    });
     window.resize(800, 600);
     window.show();
 
+    // Step 5: scan the library on a worker, reserved slots come back a few
+    // directories at a time and the loader fills them, viewport first. The
+    // cache listing and the watchers are set up once the scan is done
+    library->scan();
+
     return app.exec();
 }
 
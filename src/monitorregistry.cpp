@@ -0,0 +1,120 @@
+// monitorregistry.cpp
+#include "monitorregistry.h"
+#include "hyprsocket.h"
+#include "reload.h"
+#include <QSocketNotifier>
+#include <QDebug>
+#include <cerrno>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static const int RECONNECT_MS = 2000;
+
+MonitorRegistry::MonitorRegistry(QObject *parent)
+    : QObject(parent)
+{
+    m_reconnect.setInterval(RECONNECT_MS);
+    m_reconnect.setSingleShot(true);
+    connect(&m_reconnect, &QTimer::timeout, this, &MonitorRegistry::connectEvents);
+
+    // listening before asking, so nothing plugged in between gets lost
+    connectEvents();
+    m_monitors = getMonitorList();
+    m_listed = true;
+}
+
+MonitorRegistry::~MonitorRegistry() {
+    disconnectEvents();
+}
+
+void MonitorRegistry::connectEvents() {
+    m_fd = HyprSocket::open(HyprSocket::HyprlandEvents);
+    if (m_fd < 0) {
+        // not under Hyprland at all, nothing to wait for
+        if (HyprSocket::socketDir().isEmpty()) return;
+        m_reconnect.start();
+        return;
+    }
+
+    m_buffer.clear();
+    m_notifier = new QSocketNotifier(m_fd, QSocketNotifier::Read, this);
+    connect(m_notifier, &QSocketNotifier::activated, this, &MonitorRegistry::onReadable);
+
+    // could have missed events while we weren't listening. Hyprland that's
+    // still starting up may not answer yet, an empty list would wipe every
+    // monitor, so that keeps the old ones and the events take it from here
+    if (!m_listed) return;
+    const QStringList monitors = getMonitorList();
+    if (monitors.isEmpty()) qDebug() << "Monitor list after reconnect came back empty, keeping" << m_monitors;
+    else setMonitors(monitors);
+}
+
+void MonitorRegistry::disconnectEvents() {
+    // may be called from its own activated(), so not deleted right here
+    if (m_notifier) {
+        m_notifier->setEnabled(false);
+        m_notifier->deleteLater();
+    }
+    m_notifier = nullptr;
+    if (m_fd >= 0) ::close(m_fd);
+    m_fd = -1;
+}
+
+void MonitorRegistry::onReadable() {
+    char buffer[4096];
+    for (;;) {
+        const ssize_t n = ::recv(m_fd, buffer, sizeof buffer, 0);
+        if (n > 0) {
+            m_buffer.append(buffer, int(n));
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+
+        // hung up, Hyprland is gone or restarting
+        qDebug() << "Hyprland event socket closed, reconnecting";
+        disconnectEvents();
+        m_reconnect.start();
+        break;
+    }
+
+    int start = 0;
+    for (int nl; (nl = m_buffer.indexOf('\n', start)) >= 0; start = nl + 1)
+        handleEvent(m_buffer.mid(start, nl - start));
+    m_buffer.remove(0, start);
+}
+
+void MonitorRegistry::handleEvent(const QByteArray &line) {
+    const int sep = line.indexOf(">>");
+    if (sep < 0) return;
+    const QByteArray event = line.left(sep);
+    const QString data = QString::fromUtf8(line.mid(sep + 2));
+
+    // v1 has just the name, v2 is "id,name,description" and comes along with v1
+    // on newer Hyprland, add/remove ignore the repeat
+    if (event == "monitoradded") add(data);
+    else if (event == "monitorremoved") remove(data);
+    else if (event == "monitoraddedv2") add(data.section(',', 1, 1));
+    else if (event == "monitorremovedv2") remove(data.section(',', 1, 1));
+}
+
+void MonitorRegistry::setMonitors(const QStringList &monitors) {
+    const QStringList old = m_monitors;
+    for (const QString &name : old) {
+        if (!monitors.contains(name)) remove(name);
+    }
+    for (const QString &name : monitors) add(name);
+}
+
+void MonitorRegistry::add(const QString &name) {
+    if (name.isEmpty() || m_monitors.contains(name)) return;
+    m_monitors.append(name);
+    qDebug() << "Monitor added:" << name;
+    emit monitorAdded(name);
+}
+
+void MonitorRegistry::remove(const QString &name) {
+    if (!m_monitors.removeOne(name)) return;
+    qDebug() << "Monitor removed:" << name;
+    emit monitorRemoved(name);
+}
@@ -0,0 +1,42 @@
+// monitorregistry.h
+#pragma once
+#include <QObject>
+#include <QByteArray>
+#include <QStringList>
+#include <QTimer>
+
+class QSocketNotifier;
+
+// The monitors Hyprland knows about, asked for once and then kept up to date
+// from its event socket (.socket2.sock, monitoradded/monitorremoved), so a
+// monitor plugged in while the app is open shows up right away and nobody
+// has to ask Hyprland again at quit. If the event socket goes away (Hyprland
+// restarting) it reconnects and asks for the full list again.
+class MonitorRegistry : public QObject {
+    Q_OBJECT
+public:
+    explicit MonitorRegistry(QObject *parent = nullptr);
+    ~MonitorRegistry();
+
+    const QStringList &monitors() const { return m_monitors; }
+
+signals:
+    void monitorAdded(const QString &name);
+    void monitorRemoved(const QString &name);
+
+private:
+    QStringList m_monitors;
+    int m_fd = -1;
+    QSocketNotifier *m_notifier = nullptr;
+    QByteArray m_buffer;        // event text up to the next newline
+    QTimer m_reconnect;
+    bool m_listed = false;      // list asked for, a (re)connect after that has to catch up
+
+    void connectEvents();
+    void disconnectEvents();
+    void onReadable();
+    void handleEvent(const QByteArray &line);
+    void setMonitors(const QStringList &monitors);
+    void add(const QString &name);
+    void remove(const QString &name);
+};
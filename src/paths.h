@@ -11,3 +11,12 @@ inline QString CACHE_FOLDER() {
 inline QString HYPRPAPER_CONF() { 
     return QDir::homePath() + "/.config/hypr/hyprpaper.conf"; 
 }
+inline QString APP_CACHE_FOLDER() { 
+    return QDir::homePath() + "/.cache/qt-hyprpaper-gui"; 
+}
+inline QString LIBRARY_INDEX() { 
+    return APP_CACHE_FOLDER() + "/library.idx"; 
+}
+inline QString THUMBNAIL_PACK() { 
+    return APP_CACHE_FOLDER() + "/thumbnails.pack"; 
+}
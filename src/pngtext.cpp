@@ -0,0 +1,55 @@
+// pngtext.cpp
+#include "pngtext.h"
+#include <QFile>
+#include <QtEndian>
+#include <cstring>
+
+static const char PNG_SIGNATURE[8] = {'\x89', 'P', 'N', 'G', '\r', '\n', '\x1a', '\n'};
+// a thumbnail's text is a few hundred bytes, anything bigger isn't ours to read
+static const quint32 MAX_TEXT_CHUNK = 64 * 1024;
+
+ThumbText readThumbText(const QString &pngPath) {
+    ThumbText text;
+    QFile f(pngPath);
+    if (!f.open(QIODevice::ReadOnly)) return text;
+
+    char signature[8];
+    if (f.read(signature, 8) != 8 || std::memcmp(signature, PNG_SIGNATURE, 8) != 0) return text;
+
+    qint64 pos = 8;
+    for (;;) {
+        uchar header[8];
+        if (f.read(reinterpret_cast<char *>(header), 8) != 8) return text;
+        const quint32 length = qFromBigEndian<quint32>(header);
+        const char *type = reinterpret_cast<const char *>(header + 4);
+
+        if (std::memcmp(type, "IDAT", 4) == 0 || std::memcmp(type, "IEND", 4) == 0) break;
+
+        if (std::memcmp(type, "tEXt", 4) == 0 && length <= MAX_TEXT_CHUNK) {
+            const QByteArray data = f.read(length);
+            if (quint32(data.size()) != length) return text;
+            const int sep = data.indexOf('\0');
+            if (sep > 0) {
+                const QByteArray key = data.left(sep);
+                const QByteArray value = data.mid(sep + 1);
+                if (key == "Thumb::URI") text.uri = QString::fromLatin1(value);
+                else if (key == "Thumb::MTime") text.mtime = value.toLongLong();
+                else if (key == "Thumb::Size") text.size = value.toLongLong();
+            }
+        }
+
+        // data + crc
+        pos += 8 + qint64(length) + 4;
+        if (!f.seek(pos)) return text;
+    }
+
+    text.valid = true;
+    return text;
+}
+
+bool isThumbnailStale(const ThumbText &text, qint64 mtime, qint64 size) {
+    if (!text.valid) return false; // unreadable, the loader will find out
+    if (text.mtime >= 0 && mtime > 0 && text.mtime != mtime / 1000000000LL) return true;
+    if (text.size >= 0 && size > 0 && text.size != size) return true;
+    return false;
+}
@@ -0,0 +1,22 @@
+// pngtext.h
+#pragma once
+#include <QString>
+
+// What a freedesktop thumbnail says about the file it was made from
+struct ThumbText {
+    bool valid = false;     // a png we could walk up to its pixel data
+    QString uri;
+    qint64 mtime = -1;      // Thumb::MTime, seconds, -1 if missing
+    qint64 size = -1;       // Thumb::Size, bytes, -1 if missing
+};
+
+// Reads the png signature and chunk headers up to the first IDAT, only the
+// tEXt chunks are read in full. No pixel data is touched.
+ThumbText readThumbText(const QString &pngPath);
+
+// The thumbnail was made from an older version of the file (mtime in ns).
+// Missing keys can't prove anything, so those count as fresh.
+bool isThumbnailStale(const ThumbText &text, qint64 mtime, qint64 size);
+inline bool isThumbnailStale(const QString &pngPath, qint64 mtime, qint64 size) {
+    return isThumbnailStale(readThumbText(pngPath), mtime, size);
+}
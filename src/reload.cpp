@@ -11,6 +11,7 @@
 #include <QJsonObject>
 
 #include "paths.h"
+#include "hyprsocket.h"
 
 // Map: monitor → last clicked wallpaper file
 static QMap<QString, QString> lastClickedWallpapers;
@@ -23,15 +24,11 @@ void recordClick(const QString &monitor, const QString &filePath) {
 // -------------------------------
 // Monitor fetcher
 // -------------------------------
-// get monitors from hyprctl
+// get monitors from Hyprland's socket (hyprctl if it isn't there)
 
 QStringList getMonitorList() {
     QStringList monitors;
-    QProcess proc;
-    proc.start("hyprctl", QStringList() << "monitors" << "-j");
-    proc.waitForFinished();
-
-    QString output = proc.readAllStandardOutput();
+    QString output = HyprSocket::call(HyprSocket::Hyprland, "j/monitors", {"monitors", "-j"});
     QJsonDocument doc = QJsonDocument::fromJson(output.toUtf8());
 
     if (doc.isArray()) {
@@ -87,39 +84,40 @@ void loadLastClickedWallpapers() {
 // Update hyprpaper realtime
 // -------------------------
 
-// Run hyprctl preload + wallpaper. 
-void updateHyprpaperWallpaper(const QString &monitor, const QString &filePath) {
-    if (monitor.isEmpty() || filePath.isEmpty()) return;
-
-    // preload
-    {
-        QProcess p;
-        p.start("hyprctl", QStringList() << "hyprpaper" << "preload" << filePath);
-        if (!p.waitForFinished(1000)) p.waitForFinished();
-        QString out = p.readAllStandardOutput() + p.readAllStandardError();
-        qDebug() << "Preload output:" << out.trimmed();
-    }
+static bool isOk(const QString &reply) {
+    return reply.trimmed().startsWith("ok", Qt::CaseInsensitive);
+}
+
+bool preloadWallpaper(const QString &filePath, QString &error) {
+    QString out = HyprSocket::call(HyprSocket::Hyprpaper, ("preload " + filePath).toUtf8(),
+                                   {"hyprpaper", "preload", filePath});
+    qDebug() << "Preload output:" << out.trimmed();
+    if (isOk(out)) return true;
+    error = out.trimmed();
+    return false;
+}
 
-    // wallpaper: attempt without space, then with space if hyprctl reports unknown request
+bool setWallpaper(const QString &monitor, const QString &filePath, QString &error) {
+    // attempt without space, then with space if hyprpaper reports unknown request
     QString argNoSpace = QString("%1,%2").arg(monitor, filePath);
     QString argWithSpace = QString("%1, %2").arg(monitor, filePath);
 
-    QProcess p2;
-    p2.start("hyprctl", QStringList() << "hyprpaper" << "wallpaper" << argNoSpace);
-    if (!p2.waitForFinished(1000)) p2.waitForFinished();
-    QString out2 = p2.readAllStandardOutput() + p2.readAllStandardError();
-    qDebug() << "Wallpaper set (no-space) output:" << out2.trimmed();
-
-    if (out2.contains("unknown request", Qt::CaseInsensitive)) {
-        QProcess p3;
-        p3.start("hyprctl", QStringList() << "hyprpaper" << "wallpaper" << argWithSpace);
-        if (!p3.waitForFinished(1000)) p3.waitForFinished();
-        QString out3 = p3.readAllStandardOutput() + p3.readAllStandardError();
-        qDebug() << "Wallpaper set (with-space) output:" << out3.trimmed();
+    QString out = HyprSocket::call(HyprSocket::Hyprpaper, ("wallpaper " + argNoSpace).toUtf8(),
+                                   {"hyprpaper", "wallpaper", argNoSpace});
+    qDebug() << "Wallpaper set (no-space) output:" << out.trimmed();
+
+    if (out.contains("unknown request", Qt::CaseInsensitive)) {
+        out = HyprSocket::call(HyprSocket::Hyprpaper, ("wallpaper " + argWithSpace).toUtf8(),
+                               {"hyprpaper", "wallpaper", argWithSpace});
+        qDebug() << "Wallpaper set (with-space) output:" << out.trimmed();
     }
+    if (isOk(out)) return true;
+    error = out.trimmed();
+    return false;
+}
 
-    // update in-memory record
-    lastClickedWallpapers[monitor] = filePath;
+void unloadWallpaper(const QString &filePath) {
+    HyprSocket::call(HyprSocket::Hyprpaper, ("unload " + filePath).toUtf8(), {"hyprpaper", "unload", filePath});
 }
 
 // -------------------------------
@@ -127,7 +125,7 @@ void updateHyprpaperWallpaper(const QString &monitor, const QString &filePath) {
 // -------------------------------
 
 // Write hyprpaper.conf placing preload lines at lines 11..20 and wallpaper lines at 21..30---> We're gonna readjust this thing when someone says "YEAH 20 MONITORS BABY, WHERE THE GOD DAMN FIX"
-void updateHyprpaperConf() {
+void updateHyprpaperConf(const QStringList &monitors) {
     QFile file(HYPRPAPER_CONF());
     QStringList originalLines;
     if (file.exists()) {
@@ -187,8 +185,6 @@ void updateHyprpaperConf() {
     while (base.size() < WALLPAPER_START + WALLPAPER_COUNT)
         base.append(QString());
 
-    QStringList monitors = getMonitorList();
-
     // Preload slots
     for (int i = 0; i < PRELOAD_COUNT; ++i) {
         QString l;
@@ -227,9 +223,9 @@ void updateHyprpaperConf() {
     file.close();
 
     // 🔹 Extra: RAM CLEANUP TIME 
-    int ret = QProcess::execute("hyprctl", {"hyprpaper", "unload", "unused"});
-    if (ret != 0) {
-        qWarning() << "Failed to run hyprctl hyprpaper unload unused";
+    QString unloaded = HyprSocket::call(HyprSocket::Hyprpaper, "unload unused", {"hyprpaper", "unload", "unused"});
+    if (!unloaded.trimmed().startsWith("ok", Qt::CaseInsensitive)) {
+        qWarning() << "Failed to unload unused wallpapers:" << unloaded.trimmed();
     } else {
         qDebug() << "RAM cleaning :  unloaded unused wallpapers";
     }
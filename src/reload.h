@@ -7,14 +7,17 @@
 // Click tracking
 void recordClick(const QString &monitor, const QString &filePath);
 
-// Config updates
-void updateHyprpaperConf();
+// Config updates, monitors in the order their slots are written
+void updateHyprpaperConf(const QStringList &monitors);
 
 // Preload helpers
 void loadLastClickedWallpapers();
 
-// Wallpaper Set
-void updateHyprpaperWallpaper(const QString &monitor, const QString &filePath);
+// Single steps of a wallpaper change, blocking but safe on any thread.
+// error gets hyprpaper's reply when it isn't "ok"
+bool preloadWallpaper(const QString &filePath, QString &error);
+bool setWallpaper(const QString &monitor, const QString &filePath, QString &error);
+void unloadWallpaper(const QString &filePath);
 
 // Monitor List
 QStringList getMonitorList();
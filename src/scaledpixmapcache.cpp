@@ -0,0 +1,70 @@
+// scaledpixmapcache.cpp
+#include "scaledpixmapcache.h"
+#include <QImage>
+#include <QThread>
+#include <QtMath>
+
+// Enough for a few screens of large thumbnails at the biggest zoom
+static const qint64 DEFAULT_BUDGET_BYTES = 192LL * 1024 * 1024;
+
+ScaledPixmapCache::ScaledPixmapCache(QObject *parent)
+    : QObject(parent)
+{
+    setBudget(DEFAULT_BUDGET_BYTES);
+    // leave most cores to the thumbnail loader
+    m_pool.setMaxThreadCount(qMax(1, QThread::idealThreadCount() / 2));
+}
+
+ScaledPixmapCache::~ScaledPixmapCache() {
+    m_pool.clear();
+    m_pool.waitForDone();
+}
+
+QSize ScaledPixmapCache::deviceSize(const QSize &size, qreal dpr) {
+    return QSize(qRound(size.width() * dpr), qRound(size.height() * dpr));
+}
+
+QPixmap ScaledPixmapCache::get(const QPixmap &source, const QSize &size, qreal dpr) {
+    if (source.isNull()) return QPixmap();
+    QPixmap *pix = m_cache.object({source.cacheKey(), deviceSize(size, dpr)});
+    return pix ? *pix : QPixmap();
+}
+
+void ScaledPixmapCache::request(const QList<QPair<QPixmap, QSize>> &items, qreal dpr) {
+    if (items.isEmpty()) return;
+
+    const int tierHeight = deviceSize(items.first().second, dpr).height();
+    if (tierHeight != m_pendingHeight) {
+        // zoom moved on, whatever hasn't started yet is for a size nobody draws
+        m_pool.clear();
+        m_pending.clear();
+        m_pendingHeight = tierHeight;
+    }
+
+    for (const auto &item : items) {
+        const QPixmap &source = item.first;
+        const ScaledKey key{source.cacheKey(), deviceSize(item.second, dpr)};
+        if (source.isNull() || key.size.isEmpty()) continue;
+        if (m_pending.contains(key) || m_cache.contains(key)) continue;
+
+        // same size as the source, nothing to gain
+        if (key.size == source.size()) continue;
+
+        m_pending.insert(key);
+        // shares the raster pixmap's buffer, no copy on the GUI thread
+        const QImage image = source.toImage();
+
+        m_pool.start([this, key, image, dpr]() {
+            QImage scaledImage = image.scaled(key.size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+
+            QMetaObject::invokeMethod(this, [this, key, scaledImage, dpr]() mutable {
+                m_pending.remove(key);
+                QPixmap *pix = new QPixmap(QPixmap::fromImage(std::move(scaledImage)));
+                pix->setDevicePixelRatio(dpr);
+                const int cost = qMax<qint64>(1, qint64(pix->width()) * pix->height() * 4 / 1024);
+                m_cache.insert(key, pix, cost);
+                emit scaled();
+            }, Qt::QueuedConnection);
+        });
+    }
+}
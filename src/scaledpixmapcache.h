@@ -0,0 +1,61 @@
+// scaledpixmapcache.h
+#pragma once
+#include <QObject>
+#include <QCache>
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QPixmap>
+#include <QSet>
+#include <QSize>
+#include <QThreadPool>
+
+// How long the zoom slider has to sit still before a new tier gets built
+const int ZOOM_SETTLE_MS = 200;
+
+// A thumbnail pre-scaled to one zoom tier: source pixmap + size in device pixels.
+// The device size covers both the row height and the screen's pixel ratio.
+struct ScaledKey {
+    qint64 source;  // QPixmap::cacheKey() of the full-size thumbnail
+    QSize size;
+
+    bool operator==(const ScaledKey &other) const {
+        return source == other.source && size == other.size;
+    }
+};
+
+inline size_t qHash(const ScaledKey &key, size_t seed = 0) {
+    return qHashMulti(seed, key.source, key.size.width(), key.size.height());
+}
+
+// Thumbnails scaled once, off the GUI thread, to exactly the size they are
+// drawn at, so painting is a 1:1 blit instead of a smooth scale every frame.
+// Least recently drawn entries go first once the memory budget is hit, which
+// in practice means the tiers of zoom levels we left.
+class ScaledPixmapCache : public QObject {
+    Q_OBJECT
+public:
+    explicit ScaledPixmapCache(QObject *parent = nullptr);
+    ~ScaledPixmapCache();
+
+    // Scaled copy of source for a rect of logical size at dpr, null if not built (yet)
+    QPixmap get(const QPixmap &source, const QSize &size, qreal dpr);
+
+    // Build these in the background, skipping whatever is cached or already queued.
+    // Still-queued work for an older tier is dropped.
+    void request(const QList<QPair<QPixmap, QSize>> &items, qreal dpr);
+
+    void setBudget(qint64 bytes) { m_cache.setMaxCost(int(bytes / 1024)); }
+
+signals:
+    // Some scaled pixmaps landed, worth a repaint
+    void scaled();
+
+private:
+    QCache<ScaledKey, QPixmap> m_cache; // cost in KiB
+    QThreadPool m_pool;
+    QSet<ScaledKey> m_pending;
+    int m_pendingHeight = -1;           // device pixel height the queued work is for
+
+    static QSize deviceSize(const QSize &size, qreal dpr);
+};
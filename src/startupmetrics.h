@@ -0,0 +1,9 @@
+#pragma once
+#include <QElapsedTimer>
+
+// Started at the top of main(), renderers read it to report
+// the time until the first thumbnail in the viewport is drawn
+inline QElapsedTimer &startupClock() {
+    static QElapsedTimer clock;
+    return clock;
+}
@@ -0,0 +1,113 @@
+// thumbatlas.cpp
+#include "thumbatlas.h"
+#include <QImage>
+#include <QDebug>
+
+int ThumbAtlas::cellHeightFor(int pixelHeight) {
+    static const int steps[] = {32, 48, 64, 96, 128, 192, CELL_SIZE};
+    for (int h : steps)
+        if (h >= pixelHeight) return h;
+    return CELL_SIZE;
+}
+
+bool ThumbAtlas::create(int cellHeight, int cells) {
+    initializeOpenGLFunctions();
+
+    // wallpapers are rarely wider than 2:1, a large thumbnail is never wider than CELL_SIZE
+    m_cellHeight = qBound(1, cellHeight, int(CELL_SIZE));
+    m_cellWidth = qMin(2 * m_cellHeight, int(CELL_SIZE));
+    m_cellsPerRow = LAYER_SIZE / m_cellWidth;
+    m_cellsPerLayer = m_cellsPerRow * (LAYER_SIZE / m_cellHeight);
+
+    GLint maxLayers = 0;
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+    const int layers = qBound(1, (cells + m_cellsPerLayer - 1) / m_cellsPerLayer, int(maxLayers));
+
+    glGenTextures(1, &m_texture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_texture);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, LAYER_SIZE, LAYER_SIZE, layers, 0,
+                 GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    // no mipmaps, they would bleed neighbouring cells into each other
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    if (glGetError() != GL_NO_ERROR) {
+        qWarning() << "Could not allocate thumbnail atlas with" << layers << "layers";
+        destroy();
+        return false;
+    }
+
+    m_cells.fill(Cell(), layers * m_cellsPerLayer);
+    m_cellBySource.clear();
+    m_uploads = 0;
+    qDebug() << "Thumbnail atlas:" << layers << "layers," << m_cells.size() << "cells of"
+             << m_cellWidth << "x" << m_cellHeight;
+    return true;
+}
+
+void ThumbAtlas::destroy() {
+    if (m_texture) glDeleteTextures(1, &m_texture);
+    m_texture = 0;
+    m_cells.clear();
+    m_cellBySource.clear();
+}
+
+void ThumbAtlas::bind(int unit) {
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_texture);
+}
+
+int ThumbAtlas::cellFor(const QPixmap &pix, quint64 frame) {
+    if (!m_texture || pix.isNull()) return -1;
+
+    int cell = m_cellBySource.value(pix.cacheKey(), -1);
+    if (cell < 0) {
+        cell = takeCell(frame);
+        if (cell < 0) return -1;
+        upload(cell, pix);
+    }
+    m_cells[cell].lastFrame = frame;
+    return cell;
+}
+
+int ThumbAtlas::takeCell(quint64 frame) {
+    // free cell first, otherwise the one drawn longest ago
+    int oldest = -1;
+    for (int i = 0; i < m_cells.size(); ++i) {
+        const Cell &c = m_cells[i];
+        if (c.source == 0) return i;
+        if (c.lastFrame < frame && (oldest < 0 || c.lastFrame < m_cells[oldest].lastFrame)) oldest = i;
+    }
+    if (oldest >= 0) m_cellBySource.remove(m_cells[oldest].source);
+    return oldest;
+}
+
+void ThumbAtlas::upload(int cell, const QPixmap &pix) {
+    QImage img = pix.toImage();
+    if (img.width() > m_cellWidth || img.height() > m_cellHeight)
+        img = img.scaled(m_cellWidth, m_cellHeight, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    // the shader blends premultiplied
+    img = img.convertToFormat(QImage::Format_RGBA8888_Premultiplied);
+
+    const int layer = layerOf(cell);
+    const int x = (cell % m_cellsPerLayer) % m_cellsPerRow * m_cellWidth;
+    const int y = (cell % m_cellsPerLayer) / m_cellsPerRow * m_cellHeight;
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, int(img.bytesPerLine() / 4));
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, x, y, layer, img.width(), img.height(), 1,
+                    GL_RGBA, GL_UNSIGNED_BYTE, img.constBits());
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+
+    // half a texel in, so linear filtering never picks up the next cell
+    const qreal s = 1.0 / LAYER_SIZE;
+    Cell &c = m_cells[cell];
+    c.source = pix.cacheKey();
+    c.uv = QRectF(QPointF((x + 0.5) * s, (y + 0.5) * s),
+                  QPointF((x + img.width() - 0.5) * s, (y + img.height() - 0.5) * s));
+    m_cellBySource.insert(c.source, cell);
+    ++m_uploads;
+}
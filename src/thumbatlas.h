@@ -0,0 +1,61 @@
+// thumbatlas.h
+#pragma once
+#include <QOpenGLExtraFunctions>
+#include <QHash>
+#include <QPixmap>
+#include <QRectF>
+#include <QVector>
+
+// Thumbnails packed into one GL_TEXTURE_2D_ARRAY, each layer a grid of fixed
+// cells sized for the current row height, so small zooms don't waste a whole
+// "large" cell per tile. A thumbnail is uploaded once when it first becomes
+// visible and stays until its cell is needed for something newer (least
+// recently drawn first). All calls need the owning widget's context to be current.
+class ThumbAtlas : protected QOpenGLExtraFunctions {
+public:
+    static const int CELL_SIZE = 256;   // biggest cell, fits a freedesktop "large" thumbnail as is
+    static const int LAYER_SIZE = 2048;
+
+    // Texture with at least cells cells of cellHeight rows each, layers
+    // as needed. Everything uploaded before is gone
+    bool create(int cellHeight, int cells);
+    void destroy();
+    bool isCreated() const { return m_texture != 0; }
+
+    // Cell height that holds a row of pixelHeight device pixels, rounded up to
+    // a few steps so zooming doesn't recreate the texture on every pixel
+    static int cellHeightFor(int pixelHeight);
+    int cellHeight() const { return m_cellHeight; }
+
+    // Cell holding pix, uploaded now if it isn't resident yet. -1 if every cell
+    // is already taken by something drawn in this frame
+    int cellFor(const QPixmap &pix, quint64 frame);
+
+    // Texture coordinates of a cell's contents (xy = top left, zw = bottom right) and its layer
+    QRectF uvOf(int cell) const { return m_cells[cell].uv; }
+    int layerOf(int cell) const { return cell / m_cellsPerLayer; }
+
+    int capacity() const { return m_cells.size(); }
+    int uploads() const { return m_uploads; }
+
+    void bind(int unit);
+
+private:
+    struct Cell {
+        qint64 source = 0;      // QPixmap::cacheKey() of what's in it, 0 = free
+        quint64 lastFrame = 0;
+        QRectF uv;
+    };
+
+    GLuint m_texture = 0;
+    int m_cellWidth = 0;
+    int m_cellHeight = 0;
+    int m_cellsPerRow = 0;
+    int m_cellsPerLayer = 0;
+    QVector<Cell> m_cells;
+    QHash<qint64, int> m_cellBySource;
+    int m_uploads = 0;
+
+    int takeCell(quint64 frame);
+    void upload(int cell, const QPixmap &pix);
+};
@@ -0,0 +1,128 @@
+// thumblayout.cpp
+#include "thumblayout.h"
+#include <algorithm>
+
+bool ThumbLayout::ensure(const ThumbnailModel &model, int width, int rowHeight) {
+    if (m_valid && width == m_width && rowHeight == m_rowHeight && model.version() == m_modelVersion) return false;
+
+    m_valid = true;
+    m_width = width;
+    m_rowHeight = rowHeight;
+    m_modelVersion = model.version();
+
+    const int n = model.size();
+    const quint32 *folders = model.folderIds().constData();
+    const float *aspects = model.aspects().constData();
+
+    m_rects.resize(n);
+    m_rows.clear();
+
+    int y = 0;
+    int rowWidth = 0;
+    int rowStart = 0;
+    int rowCount = 0;
+    const int fallbackWidth = rowHeight * 16 / 9;
+
+    auto placeRow = [&]() {
+        if (rowCount == 0) return;
+        int x = (width - rowWidth) / 2;
+        for (int i = rowStart; i < rowStart + rowCount; ++i) {
+            const int w = m_rects[i].width();
+            m_rects[i] = QRect(x, y, w, rowHeight);
+            x += w + SPACING;
+        }
+        m_rows.append({y, rowStart, rowCount});
+    };
+
+    for (int i = 0; i < n; ++i) {
+        // tiny bias so exact ratios like 256/144 don't truncate a pixel short
+        const int w = aspects[i] > 0.0f ? int(aspects[i] * rowHeight + 1e-3f) : fallbackWidth;
+
+        // Folder gap
+        if (i > 0 && folders[i] != folders[i - 1]) {
+            placeRow();
+            y += rowHeight + FOLDER_GAP;
+            rowStart = i;
+            rowCount = 0;
+            rowWidth = 0;
+        }
+
+        // Row wrap, a thumbnail wider than the view still gets a row of its own
+        if (rowCount > 0 && rowWidth + w + SPACING > width) {
+            placeRow();
+            y += rowHeight + SPACING;
+            rowStart = i;
+            rowCount = 0;
+            rowWidth = 0;
+        }
+
+        m_rects[i] = QRect(0, 0, w, rowHeight); // x/y filled in by placeRow
+        rowWidth += w + (rowCount > 0 ? SPACING : 0);
+        ++rowCount;
+    }
+
+    // Last row
+    if (rowCount > 0) {
+        placeRow();
+        y += rowHeight + SPACING;
+    }
+    m_contentHeight = y;
+    return true;
+}
+
+int ThumbLayout::rowAtY(int y) const {
+    if (m_rows.isEmpty()) return -1;
+
+    auto it = std::upper_bound(m_rows.cbegin(), m_rows.cend(), y,
+                               [](int value, const Row &row) { return value < row.y; });
+    int r = int(it - m_rows.cbegin()) - 1;
+    if (r < 0) return 0;
+    if (y < m_rows[r].y + m_rowHeight) return r;
+    return r + 1 < m_rows.size() ? r + 1 : -1;
+}
+
+int ThumbLayout::rowOfIndex(int index) const {
+    if (index < 0 || index >= m_rects.size() || m_rows.isEmpty()) return -1;
+
+    auto it = std::upper_bound(m_rows.cbegin(), m_rows.cend(), index,
+                               [](int value, const Row &row) { return value < row.first; });
+    return int(it - m_rows.cbegin()) - 1;
+}
+
+bool ThumbLayout::rowsInRect(const QRect &rect, int &first, int &last) const {
+    first = rowAtY(rect.top());
+    if (first < 0 || rect.isEmpty()) return false;
+
+    auto it = std::upper_bound(m_rows.cbegin(), m_rows.cend(), rect.bottom(),
+                               [](int value, const Row &row) { return value < row.y; });
+    last = int(it - m_rows.cbegin()) - 1;
+    return last >= first;
+}
+
+int ThumbLayout::indexAt(const QPoint &pos) const {
+    int r = rowAtY(pos.y());
+    if (r < 0) return -1;
+
+    const Row &row = m_rows[r];
+    if (pos.y() < row.y || pos.y() >= row.y + m_rowHeight) return -1; // in a gap
+
+    // rects in a row are ordered left to right
+    auto begin = m_rects.cbegin() + row.first;
+    auto end = begin + row.count;
+    auto it = std::upper_bound(begin, end, pos.x(),
+                               [](int value, const QRect &rect) { return value < rect.left(); });
+    if (it == begin) return -1;
+    --it;
+    return it->contains(pos) ? int(it - m_rects.cbegin()) : -1;
+}
+
+int ThumbLayout::indexAtY(int y) const {
+    int r = rowAtY(y);
+    if (r < 0) return m_rects.size() - 1;
+    return m_rows[r].first;
+}
+
+int ThumbLayout::yOfIndex(int index) const {
+    int r = rowOfIndex(index);
+    return r < 0 ? 0 : m_rows[r].y;
+}
@@ -0,0 +1,53 @@
+// thumblayout.h
+#pragma once
+#include <QList>
+#include <QRect>
+#include <QVector>
+#include "thumbnailmodel.h"
+
+const int SPACING = 10;
+const int FOLDER_GAP = 30;
+
+// Justified row layout of the thumbnail grid, shared by painting, hit-testing
+// and scroll positioning. It is only recomputed when the width, the row height
+// or the model version changes, lookups by y or index are binary searches.
+class ThumbLayout {
+public:
+    struct Row {
+        int y;
+        int first;      // index of the first thumbnail in this row
+        int count;
+    };
+
+    // Cheap when nothing changed since the last call, true if it had to recompute
+    bool ensure(const ThumbnailModel &model, int width, int rowHeight);
+    void invalidate() { m_valid = false; }
+
+    const QVector<QRect> &rects() const { return m_rects; }
+    const QVector<Row> &rows() const { return m_rows; }
+    int rowHeight() const { return m_rowHeight; }
+    int contentHeight() const { return m_contentHeight; }
+
+    // Row containing y, or the next row down if y falls in a gap; -1 past the end
+    int rowAtY(int y) const;
+    // Row that holds index, -1 if out of range
+    int rowOfIndex(int index) const;
+    // Rows intersecting rect as [first, last], false if none do
+    bool rowsInRect(const QRect &rect, int &first, int &last) const;
+
+    // Thumbnail under pos: binary search on row y, then on x within the row. -1 if none
+    int indexAt(const QPoint &pos) const;
+
+    int indexAtY(int y) const;
+    int yOfIndex(int index) const;
+
+private:
+    bool m_valid = false;
+    int m_width = -1;
+    int m_rowHeight = -1;
+    quint64 m_modelVersion = 0;
+
+    QVector<QRect> m_rects;
+    QVector<Row> m_rows;
+    int m_contentHeight = 0;
+};
@@ -0,0 +1,98 @@
+// thumbnailcacheset.cpp
+#include "thumbnailcacheset.h"
+#include "inotifywatcher.h"
+#include "dirscanner.h"
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QDebug>
+
+static int hexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+bool ThumbKey::fromFileName(const char *name, size_t len, ThumbKey &key) {
+    if (len != 36 || std::memcmp(name + 32, ".png", 4) != 0) return false;
+
+    quint8 md5[16];
+    for (int i = 0; i < 16; ++i) {
+        const int h = hexDigit(name[2 * i]);
+        const int l = hexDigit(name[2 * i + 1]);
+        if (h < 0 || l < 0) return false;
+        md5[i] = quint8(h << 4 | l);
+    }
+    std::memcpy(&key.hi, md5, 8);
+    std::memcpy(&key.lo, md5 + 8, 8);
+    return true;
+}
+
+ThumbnailCacheSet::ThumbnailCacheSet(const QString &cacheFolder, QObject *parent)
+    : QObject(parent), m_cacheFolder(cacheFolder)
+{
+    reload();
+}
+
+void ThumbnailCacheSet::reload() {
+    QElapsedTimer t;
+    t.start();
+
+    m_keys.clear();
+    DirScanner::listNames(m_cacheFolder, [this](const char *name, size_t len){
+        ThumbKey key;
+        if (ThumbKey::fromFileName(name, len, key)) m_keys.insert(key);
+    });
+    qDebug() << "Thumbnail cache:" << m_keys.size() << "thumbnails listed in" << t.elapsed() << "ms";
+}
+
+void ThumbnailCacheSet::watch() {
+    if (m_watcher) return;
+    m_watcher = new InotifyWatcher(m_cacheFolder, this);
+
+    // thumbnailers write a temp file and rename it into place, or write it in place.
+    // A plain create is an empty file still being written, unless it was moved in.
+    connect(m_watcher, &InotifyWatcher::fileChanged, this, &ThumbnailCacheSet::onWritten);
+    connect(m_watcher, &InotifyWatcher::fileCreated, this, [this](const QString &path){
+        if (QFileInfo(path).size() > 0) onWritten(path);
+    });
+    connect(m_watcher, &InotifyWatcher::fileRenamed, this, [this](const QString &from, const QString &to){
+        onRemoved(from);
+        onWritten(to);
+    });
+    connect(m_watcher, &InotifyWatcher::fileDeleted, this, &ThumbnailCacheSet::onRemoved);
+    // missed events, list it again
+    connect(m_watcher, &InotifyWatcher::directoryRescanNeeded, this, &ThumbnailCacheSet::resync);
+}
+
+void ThumbnailCacheSet::resync() {
+    const QSet<ThumbKey> before = m_keys;
+    reload();
+    for (const ThumbKey &key : std::as_const(m_keys))
+        if (!before.contains(key)) emit thumbnailAdded(key.toMd5());
+    for (const ThumbKey &key : before)
+        if (!m_keys.contains(key)) emit thumbnailRemoved(key.toMd5());
+}
+
+bool ThumbnailCacheSet::keyOf(const QString &path, QByteArray &md5) {
+    const QByteArray name = QFileInfo(path).fileName().toLatin1();
+    ThumbKey key;
+    if (!ThumbKey::fromFileName(name.constData(), size_t(name.size()), key)) return false;
+    md5 = key.toMd5();
+    return true;
+}
+
+void ThumbnailCacheSet::onWritten(const QString &path) {
+    QByteArray md5;
+    if (!keyOf(path, md5)) return;
+    const ThumbKey key = ThumbKey::fromMd5(md5);
+    if (m_keys.contains(key)) return; // rewritten in place, same thumbnail as far as we care
+    m_keys.insert(key);
+    emit thumbnailAdded(md5);
+}
+
+void ThumbnailCacheSet::onRemoved(const QString &path) {
+    QByteArray md5;
+    if (!keyOf(path, md5)) return;
+    if (m_keys.remove(ThumbKey::fromMd5(md5))) emit thumbnailRemoved(md5);
+}
@@ -0,0 +1,72 @@
+// thumbnailcacheset.h
+#pragma once
+#include <QObject>
+#include <QByteArray>
+#include <QHash>
+#include <QSet>
+#include <QString>
+#include <cstring>
+
+class InotifyWatcher;
+
+// md5 of a thumbnail's uri as two integers, what its <hex>.png filename spells out
+struct ThumbKey {
+    quint64 hi = 0;
+    quint64 lo = 0;
+
+    static ThumbKey fromMd5(const QByteArray &md5) {
+        ThumbKey k;
+        if (md5.size() == 16) {
+            std::memcpy(&k.hi, md5.constData(), 8);
+            std::memcpy(&k.lo, md5.constData() + 8, 8);
+        }
+        return k;
+    }
+    QByteArray toMd5() const {
+        QByteArray md5(16, Qt::Uninitialized);
+        std::memcpy(md5.data(), &hi, 8);
+        std::memcpy(md5.data() + 8, &lo, 8);
+        return md5;
+    }
+    // "<32 hex digits>.png", false for anything else in the folder
+    static bool fromFileName(const char *name, size_t len, ThumbKey &key);
+
+    bool operator==(const ThumbKey &o) const { return hi == o.hi && lo == o.lo; }
+};
+
+inline size_t qHash(const ThumbKey &k, size_t seed = 0) {
+    return qHashMulti(seed, k.hi, k.lo);
+}
+
+// Which thumbnails exist in the freedesktop cache folder. The folder is
+// shared with every other app and easily holds tens of thousands of files,
+// so it's listed once into a set instead of stat'ing <md5>.png per wallpaper,
+// and an inotify watch keeps it current (thumbnails other tools write show
+// up in the grid as soon as they're complete).
+class ThumbnailCacheSet : public QObject {
+    Q_OBJECT
+public:
+    explicit ThumbnailCacheSet(const QString &cacheFolder, QObject *parent = nullptr);
+
+    // List the folder again from scratch
+    void reload();
+    // Follow changes from now on
+    void watch();
+
+    bool contains(const QByteArray &md5) const { return m_keys.contains(ThumbKey::fromMd5(md5)); }
+    int size() const { return int(m_keys.size()); }
+
+signals:
+    void thumbnailAdded(const QByteArray &md5);
+    void thumbnailRemoved(const QByteArray &md5);
+
+private:
+    QString m_cacheFolder;
+    QSet<ThumbKey> m_keys;
+    InotifyWatcher *m_watcher = nullptr;
+
+    void onWritten(const QString &path);
+    void onRemoved(const QString &path);
+    void resync();
+    static bool keyOf(const QString &path, QByteArray &md5);
+};
@@ -0,0 +1,148 @@
+// thumbnailer.cpp
+#include "thumbnailer.h"
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QImage>
+#include <QImageReader>
+#include <QImageWriter>
+#include <QSaveFile>
+#include <QThread>
+#include <QDebug>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static const int MAX_WORKERS = 2;
+// Source bytes per second we allow ourselves to read, averaged since the queue started
+static const qint64 MAX_READ_RATE = 64ll * 1024 * 1024;
+
+// Linux I/O priority, glibc has no wrapper for it
+static void setIdleIoPriority() {
+    const int IOPRIO_WHO_PROCESS = 1;   // tid 0 = the calling thread
+    const int IOPRIO_CLASS_IDLE = 3;
+    const int IOPRIO_CLASS_SHIFT = 13;
+    ::syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT);
+}
+
+// Decode at thumbnail size and write <md5>.png atomically, false if the
+// wallpaper can't be read
+static bool writeThumbnail(const ThumbnailJob &job, qint64 &bytesRead) {
+    const QFileInfo source(job.filePath);
+    bytesRead = source.size();
+
+    QImageReader reader(job.filePath);
+    reader.setAutoTransform(true);
+    const QSize full = reader.size();
+    if (full.isValid() && (full.width() > Thumbnailer::THUMB_SIZE || full.height() > Thumbnailer::THUMB_SIZE))
+        reader.setScaledSize(full.scaled(Thumbnailer::THUMB_SIZE, Thumbnailer::THUMB_SIZE, Qt::KeepAspectRatio));
+
+    QImage img = reader.read();
+    if (img.isNull()) return false;
+    // formats without scaled decoding hand back the full image
+    if (img.width() > Thumbnailer::THUMB_SIZE || img.height() > Thumbnailer::THUMB_SIZE)
+        img = img.scaled(Thumbnailer::THUMB_SIZE, Thumbnailer::THUMB_SIZE, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+
+    // freedesktop thumbnail spec, the uri matches the one our md5 is taken from
+    img.setText("Thumb::URI", "file://" + source.absoluteFilePath());
+    img.setText("Thumb::MTime", QString::number(source.lastModified().toSecsSinceEpoch()));
+    img.setText("Thumb::Size", QString::number(source.size()));
+    img.setText("Software", "QtHyprpaperGUI");
+
+    QSaveFile f(job.cachedPath);
+    if (!f.open(QIODevice::WriteOnly)) return false;
+    QImageWriter writer(&f, "png");
+    if (!writer.write(img)) {
+        f.cancelWriting();
+        return false;
+    }
+    f.setPermissions(QFileDevice::ReadOwner | QFileDevice::WriteOwner);
+    return f.commit();
+}
+
+Thumbnailer::Thumbnailer(const QString &cacheFolder, QObject *parent)
+    : QObject(parent), m_cacheFolder(cacheFolder)
+{
+    m_pool.setMaxThreadCount(MAX_WORKERS);
+    m_pool.setThreadPriority(QThread::LowPriority);
+
+    m_throttle.setSingleShot(true);
+    connect(&m_throttle, &QTimer::timeout, this, &Thumbnailer::pump);
+}
+
+Thumbnailer::~Thumbnailer() {
+    m_abort = true;
+    m_pool.clear();
+    m_pool.waitForDone();
+}
+
+void Thumbnailer::generate(const QList<ThumbnailJob> &jobs) {
+    bool added = false;
+    for (const ThumbnailJob &job : jobs) {
+        if (job.md5.isEmpty() || m_known.contains(job.md5)) continue;
+        m_known.insert(job.md5);
+        m_queue.append(job);
+        added = true;
+    }
+    if (!added) return;
+
+    if (m_inFlight == 0 && !m_throttle.isActive()) {
+        m_rateClock.start();
+        m_bytesRead = 0;
+        QDir().mkpath(m_cacheFolder);
+    }
+    qDebug() << "Thumbnailer:" << m_queue.size() << "wallpapers queued";
+    pump();
+}
+
+void Thumbnailer::prioritize(const QStringList &dirs) {
+    if (m_queue.isEmpty() || dirs.isEmpty()) return;
+
+    // stable, so library order holds within both halves
+    QList<ThumbnailJob> first, rest;
+    for (const ThumbnailJob &job : std::as_const(m_queue)) {
+        const QString dir = job.filePath.left(job.filePath.lastIndexOf('/'));
+        (dirs.contains(dir) ? first : rest).append(job);
+    }
+    if (first.isEmpty()) return;
+    m_queue = first + rest;
+}
+
+void Thumbnailer::pump() {
+    while (m_inFlight < MAX_WORKERS && !m_queue.isEmpty()) {
+        // ahead of the read budget, come back once we're under it again
+        const qint64 allowed = qMax<qint64>(1, m_rateClock.elapsed()) * MAX_READ_RATE / 1000;
+        if (m_bytesRead > allowed) {
+            m_throttle.start(int(qMin<qint64>(1000, (m_bytesRead - allowed) * 1000 / MAX_READ_RATE + 1)));
+            return;
+        }
+
+        const ThumbnailJob job = m_queue.takeFirst();
+        ++m_inFlight;
+        m_pool.start([this, job](){
+            if (m_abort) return;
+            setIdleIoPriority();
+            qint64 bytesRead = 0;
+            const bool ok = writeThumbnail(job, bytesRead);
+            QMetaObject::invokeMethod(this, [this, job, ok, bytesRead](){ onDone(job, ok, bytesRead); },
+                                      Qt::QueuedConnection);
+        });
+    }
+}
+
+void Thumbnailer::onDone(const ThumbnailJob &job, bool ok, qint64 bytesRead) {
+    --m_inFlight;
+    m_bytesRead += bytesRead;
+    m_known.remove(job.md5); // edited again later, or still being copied when it failed
+    if (ok) {
+        ++m_generated;
+        emit generated(job.filePath);
+    } else {
+        ++m_failed;
+        qDebug() << "Could not thumbnail" << job.filePath;
+    }
+
+    if (pending() == 0)
+        qDebug() << "Thumbnailer done:" << m_generated << "generated," << m_failed << "failed";
+    pump();
+}
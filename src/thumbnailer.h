@@ -0,0 +1,56 @@
+// thumbnailer.h
+#pragma once
+#include <QObject>
+#include <QElapsedTimer>
+#include <QList>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <QTimer>
+#include <atomic>
+#include "thumbnailloader.h"
+
+// Writes freedesktop thumbnails for wallpapers nobody has thumbnailed yet.
+// Decoding happens at thumbnail resolution (QImageReader::setScaledSize),
+// the png carries Thumb::URI/Thumb::MTime/Thumb::Size and is renamed into
+// the cache in one go, so the cache watcher picks it up once it's complete.
+// Few workers at idle I/O priority plus a read-rate cap, a folder full of
+// 8K images shouldn't compete with the grid for the disk.
+class Thumbnailer : public QObject {
+    Q_OBJECT
+public:
+    static const int THUMB_SIZE = 256;  // "large"
+
+    explicit Thumbnailer(const QString &cacheFolder, QObject *parent = nullptr);
+    ~Thumbnailer();
+
+    // Queue wallpapers without a thumbnail (or with a stale one), ones already queued are skipped
+    void generate(const QList<ThumbnailJob> &jobs);
+    // Wallpapers in these folders go first, e.g. the folders in the viewport
+    void prioritize(const QStringList &dirs);
+
+    int pending() const { return int(m_queue.size()) + m_inFlight; }
+
+signals:
+    void generated(const QString &filePath);
+
+private:
+    QString m_cacheFolder;
+    QThreadPool m_pool;
+    QList<ThumbnailJob> m_queue;
+    QSet<QByteArray> m_known;       // queued or in flight, by md5
+    int m_inFlight = 0;
+    std::atomic<bool> m_abort{false};
+
+    // read-rate cap
+    QElapsedTimer m_rateClock;
+    qint64 m_bytesRead = 0;
+    QTimer m_throttle;
+
+    int m_generated = 0;
+    int m_failed = 0;
+
+    void pump();
+    void onDone(const ThumbnailJob &job, bool ok, qint64 bytesRead);
+};
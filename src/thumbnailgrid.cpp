@@ -0,0 +1,234 @@
+// thumbnailgrid.cpp
+#include "thumbnailgrid.h"
+#include <QPainter>
+#include <QMouseEvent>
+#include <QPaintEvent>
+#include <QFileInfo>
+#include <QtMath>
+#include <QDateTime>
+#include "startupmetrics.h"
+#include "animationdriver.h"
+
+ThumbnailGrid::ThumbnailGrid(ThumbnailLibrary *library, QWidget *parent)
+    : QWidget(parent), m_library(library), m_model(library->model())
+{
+    setAttribute(Qt::WA_TranslucentBackground);
+    setMouseTracking(true);
+
+    // one library for whichever renderer, we only draw what it has
+    connect(m_library, &ThumbnailLibrary::modelReset, this, &ThumbnailGrid::modelReset);
+    connect(m_library, &ThumbnailLibrary::thumbnailsLoaded, this, [this](){ requestFrame(); });
+
+    // a zoom tier is only built once the slider stops moving
+    m_zoomSettle.setSingleShot(true);
+    connect(&m_zoomSettle, &QTimer::timeout, this, [this](){
+        m_settledZoom = THUMB_HEIGHT;
+        updateTier();
+        requestFrame();
+    });
+    connect(&m_scaled, &ScaledPixmapCache::scaled, this, [this](){ requestFrame(); });
+
+    // hover pulse / click flash, only ticks while one of them is running
+    m_animation = new AnimationDriver(this);
+    connect(m_animation, &AnimationDriver::frame, this, &ThumbnailGrid::animate);
+}
+
+void ThumbnailGrid::modelReset() {
+    // indices shifted, anything pointing into the old list is meaningless now
+    m_hoveredIndex = -1;
+    m_clickedIndex = -1;
+    m_lastWanted.clear();
+    requestFrame();
+}
+
+void ThumbnailGrid::ensureLayout() {
+    if (!m_layout.ensure(m_model, width(), THUMB_HEIGHT)) return;
+
+    // content height comes from the layout pass, applied outside of paint
+    QMetaObject::invokeMethod(this, [this](){ setMinimumHeight(m_layout.contentHeight()); },
+                              Qt::QueuedConnection);
+}
+
+void ThumbnailGrid::trackZoom() {
+    // first zoom needs no settling, later ones wait until the slider stops
+    if (m_settledZoom < 0) {
+        m_lastZoom = m_settledZoom = THUMB_HEIGHT;
+        updateTier();
+    }
+    if (THUMB_HEIGHT == m_lastZoom) return;
+    m_lastZoom = THUMB_HEIGHT;
+    m_zoomSettle.start(ZOOM_SETTLE_MS);
+}
+
+void ThumbnailGrid::updateTier() {
+    m_library->setTargetHeight(qMin(qRound(THUMB_HEIGHT * devicePixelRatioF()), maxTierHeight()));
+}
+
+int ThumbnailGrid::getThumbnailIndexAtY(int y) {
+    ensureLayout();
+    return m_layout.indexAtY(y);
+}
+
+int ThumbnailGrid::getYPositionOfThumbnail(int index) {
+    ensureLayout();
+    return m_layout.yOfIndex(index);
+}
+
+void ThumbnailGrid::requestFrame(const QRect &rect) {
+    if (rect.isNull()) update();
+    else update(rect);
+}
+
+void ThumbnailGrid::updateResidency(const QRect &view) {
+    // evict far away pixmaps, ask for the ones coming into view
+    int first, last;
+    if (!m_layout.rowsInRect(view, first, last)) return;
+    const QVector<ThumbLayout::Row> &rows = m_layout.rows();
+    m_library->viewportChanged(rows[first].first, rows[last].first + rows[last].count - 1);
+}
+
+void ThumbnailGrid::beginFrame(const QRect &view) {
+    ensureLayout();
+    trackZoom();
+    m_visibleRect = view;
+    m_wanted.clear();
+    updateResidency(view);
+}
+
+void ThumbnailGrid::drawn(int i, const QRect &rect, const QPixmap &thumb) {
+    if (!m_visibleRect.intersects(rect)) return;
+    if (thumb.isNull()) {
+        m_wanted.append(i);
+    } else if (m_firstVisibleMs < 0) {
+        m_firstVisibleMs = startupClock().elapsed();
+        emit firstThumbnailVisible(m_firstVisibleMs);
+    }
+}
+
+void ThumbnailGrid::endFrame() {
+    // same placeholders as last frame were already asked for
+    if (!m_wanted.isEmpty() && m_wanted != m_lastWanted) m_library->prioritize(m_wanted);
+    m_lastWanted = m_wanted;
+}
+
+void ThumbnailGrid::paintEvent(QPaintEvent *event) {
+    QPainter painter(this);
+    painter.setRenderHint(QPainter::SmoothPixmapTransform);
+
+    beginFrame(visibleRegion().boundingRect());
+    m_toScale.clear();
+
+    // Only the rows in the exposed area, cost follows what is on screen
+    int first, last;
+    if (m_layout.rowsInRect(event->rect(), first, last)) {
+        const QVector<ThumbLayout::Row> &rows = m_layout.rows();
+        for (int r = first; r <= last; ++r) drawRow(painter, rows[r]);
+    }
+    endFrame();
+
+    // Tiles still drawn with a smooth scale get their own tier in the background
+    m_scaled.request(m_toScale, devicePixelRatioF());
+}
+
+void ThumbnailGrid::drawRow(QPainter &painter, const ThumbLayout::Row &row) {
+    const QVector<QRect> &rects = m_layout.rects();
+
+    for (int i = row.first; i < row.first + row.count; ++i) {
+        const QPixmap &thumb = m_model.pixmap(i);
+        const QRect &thumbRect = rects[i];
+        drawn(i, thumbRect, thumb);
+
+        // Reserved slot, the thumbnail is still being decoded
+        if (thumb.isNull()) {
+            painter.fillRect(thumbRect, QColor(255, 255, 255, 20));
+            continue;
+        }
+
+        // 1:1 blit when this zoom's tier is built, smooth scale until then
+        QPixmap pix = m_scaled.get(thumb, thumbRect.size(), devicePixelRatioF());
+        if (pix.isNull()) {
+            if (m_settledZoom == THUMB_HEIGHT) m_toScale.append({thumb, thumbRect.size()});
+            pix = thumb;
+        }
+
+        if (i == m_hoveredIndex) {
+            // Hover flash: subtle pulsing white overlay, straight onto the widget
+            int hoverAlpha = 40 + int(15 * std::sin(QDateTime::currentMSecsSinceEpoch() / 100.0));
+            painter.drawPixmap(thumbRect, pix);
+            painter.fillRect(thumbRect, QColor(255, 255, 255, hoverAlpha));
+        } else {
+            painter.setOpacity(0.85);
+            painter.drawPixmap(thumbRect, pix);
+            painter.setOpacity(1.0);
+        }
+
+        // Click flash: temporary white overlay
+        if (i == m_clickedIndex && m_clickFlashProgress > 0.0)
+            painter.fillRect(thumbRect, QColor(255, 255, 255, int(100 * m_clickFlashProgress)));
+    }
+}
+
+void ThumbnailGrid::resizeEvent(QResizeEvent *event) {
+    QWidget::resizeEvent(event);
+    requestFrame();
+}
+
+void ThumbnailGrid::mousePressEvent(QMouseEvent *event) {
+    ensureLayout();
+    m_clickedIndex = m_layout.indexAt(event->pos());
+    if (m_clickedIndex >= 0) {
+        m_clickFlashProgress = 1.0; // full flash, fades out in animate()
+        m_clickClock.start();
+        m_animation->start();
+        requestFrame(m_layout.rects()[m_clickedIndex]);
+    }
+
+    if (m_clickedIndex >= 0 && m_clickedIndex < m_model.size()) {
+        QString filePath = QFileInfo(m_model.filePath(m_clickedIndex)).absoluteFilePath();
+        if (event->modifiers() & Qt::ShiftModifier) emit wallpaperSpreadChosen(m_clickedIndex);
+        else emit wallpaperChosen(m_currentMonitor, filePath); // sent to hyprpaper off the GUI thread
+    }
+
+    QWidget::mousePressEvent(event);
+}
+
+void ThumbnailGrid::mouseMoveEvent(QMouseEvent *event) {
+    ensureLayout();
+    const int index = m_layout.indexAt(event->pos());
+    if (index != m_hoveredIndex) {
+        // repaint just the tile we left and the one we entered
+        const QVector<QRect> &rects = m_layout.rects();
+        if (m_hoveredIndex >= 0 && m_hoveredIndex < rects.size()) requestFrame(rects[m_hoveredIndex]);
+        if (index >= 0) requestFrame(rects[index]);
+        m_hoveredIndex = index;
+        emit wallpaperHovered(index >= 0 ? QFileInfo(m_model.filePath(index)).absoluteFilePath() : QString());
+    }
+    if (m_hoveredIndex >= 0) m_animation->start();   // start pulsing
+    QWidget::mouseMoveEvent(event);
+}
+
+void ThumbnailGrid::leaveEvent(QEvent *event) {
+    const QVector<QRect> &rects = m_layout.rects();
+    if (m_hoveredIndex >= 0 && m_hoveredIndex < rects.size()) requestFrame(rects[m_hoveredIndex]);
+    m_hoveredIndex = -1;   // pulsing stops on the next frame
+    emit wallpaperHovered(QString());
+    QWidget::leaveEvent(event);
+}
+
+void ThumbnailGrid::animate() {
+    // repaint just the animated tiles, the driver stops once nothing moves
+    const QVector<QRect> &rects = m_layout.rects();
+    bool running = false;
+
+    if (m_hoveredIndex >= 0 && m_hoveredIndex < rects.size()) {
+        requestFrame(rects[m_hoveredIndex]);
+        running = true;
+    }
+    if (m_clickFlashProgress > 0.0) {
+        m_clickFlashProgress = qMax(0.0, 1.0 - m_clickClock.elapsed() / qreal(CLICK_FLASH_MS));
+        if (m_clickedIndex >= 0 && m_clickedIndex < rects.size()) requestFrame(rects[m_clickedIndex]);
+        running |= m_clickFlashProgress > 0.0;
+    }
+
+    if (!running) m_animation->stop();
+}
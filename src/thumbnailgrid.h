@@ -0,0 +1,97 @@
+// thumbnailgrid.h
+#pragma once
+#include <QWidget>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QList>
+#include <QPair>
+#include <QPixmap>
+#include <QRect>
+#include <QSize>
+#include <climits>
+#include "thumbnaillibrary.h"
+#include "thumblayout.h"
+#include "scaledpixmapcache.h"
+
+extern int THUMB_HEIGHT;
+
+class AnimationDriver;
+class QPainter;
+
+// The wallpaper grid both renderers share: layout, zoom tiers, viewport hints
+// to the library, hover/click tracking and the QPainter drawing path. QHppQ
+// paints with it as is, QHppQ_GPU hands the frames to an OpenGL viewport
+// and only falls back to it.
+class ThumbnailGrid : public QWidget {
+    Q_OBJECT
+public:
+    explicit ThumbnailGrid(ThumbnailLibrary *library, QWidget *parent = nullptr);
+
+    QString currentMonitor() const { return m_currentMonitor; }
+    void setCurrentMonitor(const QString &monitor) { m_currentMonitor = monitor; }
+
+    int getThumbnailIndexAtY(int y);
+    int getYPositionOfThumbnail(int index);
+
+    // ms from startup until the first real thumbnail was drawn in view, -1 until then
+    qint64 firstVisibleThumbnailMs() const { return m_firstVisibleMs; }
+
+signals:
+    void firstThumbnailVisible(qint64 ms);
+    void wallpaperChosen(const QString &monitor, const QString &filePath);
+    void wallpaperSpreadChosen(int index);              // shift-click: index and the ones after it, one per monitor
+    void wallpaperHovered(const QString &filePath);     // empty when the mouse left
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+    void leaveEvent(QEvent *event) override;
+
+    // Repaint rect (grid coordinates), null = everything
+    virtual void requestFrame(const QRect &rect = QRect());
+    // Biggest thumbnail height in device pixels worth loading
+    virtual int maxTierHeight() const { return INT_MAX; }
+
+    // A frame over view starts: layout, zoom and residency are brought up to date
+    void beginFrame(const QRect &view);
+    // Slot i is drawn at rect, placeholders in view get decoded first
+    void drawn(int i, const QRect &rect, const QPixmap &thumb);
+    // ...and it's done, the loader hears about what's missing on screen
+    void endFrame();
+    void updateTier();
+
+    ThumbnailLibrary *m_library;
+    ThumbnailModel &m_model;
+    ThumbLayout m_layout;
+    QString m_currentMonitor;
+
+    // Hover / click tracking
+    int m_hoveredIndex = -1;
+    int m_clickedIndex = -1;
+    qreal m_clickFlashProgress = 0.0;
+    QElapsedTimer m_clickClock;
+    AnimationDriver *m_animation;
+
+    // Progressive loading
+    QRect m_visibleRect;
+    QList<int> m_wanted;
+    QList<int> m_lastWanted;
+    qint64 m_firstVisibleMs = -1;
+
+    // Pre-scaled tiers, only built once the zoom has settled
+    ScaledPixmapCache m_scaled;
+    QTimer m_zoomSettle;
+    int m_lastZoom = -1;
+    int m_settledZoom = -1;
+    QList<QPair<QPixmap, QSize>> m_toScale;
+
+private:
+    void animate();
+    void modelReset();
+    void ensureLayout();
+    void trackZoom();
+    void updateResidency(const QRect &view);
+    void drawRow(QPainter &painter, const ThumbLayout::Row &row);
+};
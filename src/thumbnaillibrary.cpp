@@ -0,0 +1,225 @@
+// thumbnaillibrary.cpp
+#include "thumbnaillibrary.h"
+#include <QHash>
+#include <QSet>
+#include <QThread>
+#include <QDebug>
+
+ThumbnailLibrary::ThumbnailLibrary(const QString &cacheFolder, const QString &mainFolder, QObject *parent)
+    : QObject(parent), m_cacheFolder(cacheFolder), m_mainFolder(mainFolder),
+      m_residency(cacheFolder), m_thumbnailer(cacheFolder)
+{
+    m_scanPool.setMaxThreadCount(1);
+
+    // decoded thumbnails drop into their reserved slots as they arrive
+    connect(&m_loader, &ThumbnailLoader::batchReady, this, &ThumbnailLibrary::onBatchReady);
+
+    // evicted pixmaps come back through the loader, background walk stops while the budget is full
+    connect(&m_residency, &ThumbnailResidency::reloadRequested, &m_loader, &ThumbnailLoader::requeue);
+    connect(&m_residency, &ThumbnailResidency::backgroundPaused, &m_loader, &ThumbnailLoader::setBackgroundPaused);
+
+    // ...except a regenerated stale one, its slot already exists and holds the old picture
+    connect(&m_thumbnailer, &Thumbnailer::generated, this, &ThumbnailLibrary::onThumbnailWritten);
+}
+
+void ThumbnailLibrary::scan() {
+    const int generation = ++m_scanGeneration;
+    m_streaming = m_model.isEmpty();
+    QThread *gui = thread();
+
+    // md5s, thumbnail headers and stale checks for every new wallpaper, nothing
+    // the window should wait for
+    m_scanPool.start([this, generation, gui, cacheFolder = m_cacheFolder, mainFolder = m_mainFolder]() {
+        auto *cache = new ThumbnailCacheSet(cacheFolder);
+        QList<ThumbnailJob> uncached;
+        const QList<ThumbnailJob> jobs = ThumbnailLoader::scanLibrary(cacheFolder, mainFolder, *cache, &uncached,
+                                                                      [this, generation](const QList<ThumbnailJob> &chunk){
+            QMetaObject::invokeMethod(this, [this, generation, chunk]() { onScanChunk(generation, chunk); },
+                                      Qt::QueuedConnection);
+        });
+
+        cache->moveToThread(gui);
+        QMetaObject::invokeMethod(this, [this, generation, cache, jobs, uncached]() {
+            onScanFinished(generation, cache, jobs, uncached);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void ThumbnailLibrary::onScanChunk(int generation, const QList<ThumbnailJob> &jobs) {
+    // a rescan keeps the old slots until it's done, see onScanFinished
+    if (generation != m_scanGeneration || !m_streaming) return;
+
+    // nothing resident in new placeholders, the residency count stays as it is
+    for (const ThumbnailJob &job : jobs) m_slotByPath.insert(job.filePath, job.index);
+    m_model.append(ThumbnailLoader::placeholders(jobs));
+    m_slotTier.resize(m_model.size(), -1);
+    m_loader.append(jobs);
+    emit thumbnailsLoaded();
+}
+
+void ThumbnailLibrary::onScanFinished(int generation, ThumbnailCacheSet *cache, const QList<ThumbnailJob> &jobs,
+                                      const QList<ThumbnailJob> &uncached) {
+    if (generation != m_scanGeneration) {
+        delete cache;
+        return;
+    }
+
+    if (!m_cache) {
+        // real-time inotify-based watchers, only now that the window is up and filling
+        m_cache = cache;
+        m_cache->setParent(this);
+        m_cache->watch();
+        m_tierSets[TIER_LARGE] = m_cache;
+
+        // bursts come in as one batch of single entry changes
+        m_updater = new LibraryUpdater(m_cacheFolder, m_mainFolder, m_cache, this);
+        connect(m_updater, &LibraryUpdater::changesReady, this, &ThumbnailLibrary::onChangesReady);
+        // what we thumbnail ourselves comes back through the cache watcher like anyone else's
+        connect(m_updater, &LibraryUpdater::thumbnailsMissing, &m_thumbnailer, &Thumbnailer::generate);
+    } else {
+        delete cache; // the watched one is at least as current
+    }
+    m_updater->setUncached(uncached);
+
+    // every chunk should be in the model by now, if not fall back to a full assign
+    if (m_streaming && m_model.size() != jobs.size()) m_streaming = false;
+    if (!m_streaming) {
+        // keep what is already decoded, only the new ones go to the loader
+        QHash<QString, QPixmap> decoded;
+        for (int i = 0; i < m_model.size(); ++i)
+            if (m_model.hasPixmap(i)) decoded.insert(m_model.filePath(i), m_model.pixmap(i));
+
+        QList<CachedImage> images = ThumbnailLoader::placeholders(jobs);
+        for (int i = 0; i < images.size(); ++i) images[i].pix = decoded.value(images[i].filePath);
+
+        assignModel(images);
+        m_loader.load(outdatedJobs());
+    }
+    m_streaming = false;
+
+    // stale thumbnails stay out of the pack until they've been regenerated
+    QSet<QByteArray> regenerate;
+    for (const ThumbnailJob &job : std::as_const(uncached)) regenerate.insert(job.md5);
+    QList<ThumbnailJob> packed;
+    packed.reserve(jobs.size());
+    for (const ThumbnailJob &job : std::as_const(jobs))
+        if (!regenerate.contains(job.md5)) packed.append(job);
+    m_loader.updatePack(packed);
+
+    m_thumbnailer.generate(uncached);
+}
+
+void ThumbnailLibrary::assignModel(const QList<CachedImage> &images) {
+    // pixmaps that survive keep their tier, wherever their slot went
+    QHash<QString, qint8> tierByPath;
+    for (int i = 0; i < m_model.size(); ++i)
+        if (m_model.hasPixmap(i)) tierByPath.insert(m_model.filePath(i), m_slotTier[i]);
+
+    m_model.assign(images);
+    m_slotByPath.clear();
+    m_slotByPath.reserve(m_model.size());
+    for (int i = 0; i < m_model.size(); ++i) m_slotByPath.insert(m_model.filePath(i), i);
+    m_slotTier.fill(-1, m_model.size());
+    for (int i = 0; i < m_model.size(); ++i)
+        if (m_model.hasPixmap(i)) m_slotTier[i] = tierByPath.value(m_model.filePath(i), qint8(TIER_LARGE));
+
+    m_residency.reset(m_model);
+    emit modelReset();
+}
+
+void ThumbnailLibrary::setTargetHeight(int pixelHeight) {
+    const ThumbTier tier = tierFor(pixelHeight);
+    if (tier == m_loader.tier()) return;
+
+    // the other tiers are listed the first time we leave "large"
+    for (int t = 0; t < TIER_COUNT; ++t) {
+        if (m_tierSets[t] || t == TIER_LARGE) continue; // large comes with the scan
+        m_tierSets[t] = new ThumbnailCacheSet(tierFolder(m_cacheFolder, t), this);
+        m_tierSets[t]->watch();
+    }
+    m_loader.setTier(tier, [this](int t, const QByteArray &md5){ return m_tierSets[t] && m_tierSets[t]->contains(md5); });
+    qDebug() << "Thumbnail tier:" << tierSize(tier) << "px for" << pixelHeight << "px rows";
+
+    // everything not in the new tier yet, the viewport asks for its slots first
+    m_loader.load(outdatedJobs());
+}
+
+QList<ThumbnailJob> ThumbnailLibrary::outdatedJobs() const {
+    // missing ones are -1, so this also picks up a tier reload a rescan or a
+    // change batch would otherwise cancel
+    QList<ThumbnailJob> jobs;
+    const int tier = m_loader.tier();
+    for (int i = 0; i < m_model.size(); ++i)
+        if (m_slotTier[i] != tier) jobs.append(ThumbnailLoader::jobFor(m_model, i, m_cacheFolder));
+    return jobs;
+}
+
+void ThumbnailLibrary::prioritize(const QList<int> &indices) {
+    m_loader.prioritize(indices);
+}
+
+void ThumbnailLibrary::viewportChanged(int firstVisible, int lastVisible) {
+    m_residency.update(m_model, firstVisible, lastVisible);
+
+    // wallpapers next to the ones on screen get their thumbnails first
+    if (m_thumbnailer.pending() == 0 || firstVisible < 0) return;
+    QStringList dirs;
+    for (int i = firstVisible; i <= lastVisible && i < m_model.size(); ++i) {
+        const QString &path = m_model.filePath(i);
+        const QString dir = path.left(path.lastIndexOf('/'));
+        if (!dirs.contains(dir)) dirs.append(dir);
+    }
+    m_thumbnailer.prioritize(dirs);
+}
+
+void ThumbnailLibrary::onBatchReady(const QList<LoadedThumbnail> &batch) {
+    for (const LoadedThumbnail &t : batch) {
+        // the slot may have moved on since the job was queued
+        if (t.index < 0 || t.index >= m_model.size() || m_model.filePath(t.index) != t.filePath) continue;
+        if (t.pix.isNull()) {
+            // broken png: a resident pixmap from another tier stays, otherwise the
+            // placeholder does until the thumbnailer writes a new one
+            if (!m_model.hasPixmap(t.index)) m_residency.failed(t.index);
+            continue;
+        }
+        if (m_model.hasPixmap(t.index)) {
+            if (m_slotTier[t.index] == t.tier) continue; // already resident
+
+            // zoom moved to another tier, swap it in place
+            const QPixmap old = m_model.pixmap(t.index);
+            m_model.setPixmap(t.index, t.pix);
+            m_residency.replaced(t.index, old, t.pix);
+        } else {
+            m_model.setPixmap(t.index, t.pix); // relayouts if the index didn't know the real size
+            m_residency.loaded(t.index, t.pix);
+        }
+        m_slotTier[t.index] = qint8(t.tier);
+    }
+    emit thumbnailsLoaded();
+}
+
+void ThumbnailLibrary::onThumbnailWritten(const QString &filePath) {
+    const int i = m_slotByPath.value(filePath, -1);
+    if (i < 0) return;
+    ThumbnailJob job = ThumbnailLoader::jobFor(m_model, i, m_cacheFolder);
+    job.mtime = -1;     // the pack has the pixels of the old png under the same mtime
+
+    // nothing decoded yet, it'll load the new one. One whose decode failed gets another go
+    if (!m_model.hasPixmap(i)) {
+        if (m_residency.retry(i)) m_loader.requeue({job});
+        return;
+    }
+
+    // swap the old picture for the new png, the pack may still hold the old pixels
+    m_residency.dropped(i, m_model.pixmap(i));
+    m_model.dropPixmap(i);
+    m_slotTier[i] = -1;
+    m_loader.requeue({job});
+}
+
+void ThumbnailLibrary::onChangesReady(const LibraryChanges &changes) {
+    QList<CachedImage> images = m_model.toList();
+    if (!applyLibraryChanges(images, changes)) return;
+    assignModel(images);
+    m_loader.load(outdatedJobs());
+}
@@ -0,0 +1,75 @@
+// thumbnaillibrary.h
+#pragma once
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QThreadPool>
+#include <QVector>
+#include "thumbnailmodel.h"
+#include "thumbnailloader.h"
+#include "thumbnailresidency.h"
+#include "libraryupdater.h"
+#include "thumbnailcacheset.h"
+#include "thumbnailer.h"
+#include "thumbtiers.h"
+
+// The one copy of the wallpaper library per process: scans it once, streams
+// thumbnails into the model, applies inotify changes, keeps the decoded
+// pixmaps within budget and thumbnails whatever has no thumbnail yet.
+// Both renderers draw from it through the same calls.
+class ThumbnailLibrary : public QObject {
+    Q_OBJECT
+public:
+    ThumbnailLibrary(const QString &cacheFolder, const QString &mainFolder, QObject *parent = nullptr);
+
+    ThumbnailModel &model() { return m_model; }
+    const QString &cacheFolder() const { return m_cacheFolder; }
+
+    // (Re)scan the library on a worker thread and start loading, pixmaps already
+    // decoded are kept. On the first scan slots stream into the model a few
+    // directories at a time, the cache listing and inotify watches are set up
+    // once it's done
+    void scan();
+
+    // Viewport hints from the view showing the grid
+    void prioritize(const QList<int> &indices);
+    void viewportChanged(int firstVisible, int lastVisible);
+    // Rows are this many device pixels tall now that the zoom has settled. Picks
+    // the thumbnail tier for it, slots keep their old pixmap until the new one lands
+    void setTargetHeight(int pixelHeight);
+
+signals:
+    // Slots were inserted/removed/moved, indices into the old model mean nothing now
+    void modelReset();
+    // Pixmaps landed in their slots, or the scan appended slots at the end
+    // (sizes may have changed, see model().version())
+    void thumbnailsLoaded();
+
+private:
+    QString m_cacheFolder;
+    QString m_mainFolder;
+    ThumbnailCacheSet *m_cache = nullptr;   // listed by the first scan
+    ThumbnailModel m_model;
+    ThumbnailLoader m_loader;
+    ThumbnailResidency m_residency;
+    Thumbnailer m_thumbnailer;
+    LibraryUpdater *m_updater = nullptr;
+    QThreadPool m_scanPool;                         // one scan at a time, waited for on destruction
+    int m_scanGeneration = 0;
+    bool m_streaming = false;                       // first scan, slots are appended as they come
+
+    QVector<qint8> m_slotTier;                      // tier of each slot's pixmap, -1 = none
+    QHash<QString, int> m_slotByPath;               // file path -> slot
+    ThumbnailCacheSet *m_tierSets[TIER_COUNT] = {}; // what exists per tier, large is m_cache
+
+    void onScanChunk(int generation, const QList<ThumbnailJob> &jobs);
+    void onScanFinished(int generation, ThumbnailCacheSet *cache, const QList<ThumbnailJob> &jobs,
+                        const QList<ThumbnailJob> &uncached);
+    void assignModel(const QList<CachedImage> &images);
+    // Slots without a pixmap from the loader's current tier
+    QList<ThumbnailJob> outdatedJobs() const;
+    void onBatchReady(const QList<LoadedThumbnail> &batch);
+    void onChangesReady(const LibraryChanges &changes);
+    void onThumbnailWritten(const QString &filePath);
+};
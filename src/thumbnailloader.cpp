@@ -0,0 +1,321 @@
+// thumbnailloader.cpp
+#include "thumbnailloader.h"
+#include "libraryindex.h"
+#include "thumbnailpack.h"
+#include <QFileInfo>
+#include <QThread>
+#include <QDebug>
+#include <utility>
+
+// Small enough that the first rows show up quickly, big enough that the
+// queued hand-off to the GUI thread doesn't dominate
+static const int CHUNK_SIZE = 32;
+// Viewport requests go out in small chunks so they land as soon as possible
+static const int URGENT_CHUNK_SIZE = 4;
+
+ThumbnailLoader::ThumbnailLoader(QObject *parent)
+    : QObject(parent)
+{
+    m_pool.setMaxThreadCount(QThread::idealThreadCount());
+    // one rebuild at a time, and cancel() only ever clears the decode pool
+    m_packPool.setMaxThreadCount(1);
+
+    m_pack = std::make_shared<ThumbnailPack>();
+    if (m_pack->open()) qDebug() << "Thumbnail pack:" << m_pack->count() << "thumbnails";
+}
+
+ThumbnailLoader::~ThumbnailLoader() {
+    m_packAbort = true;
+    cancel();
+    m_pool.waitForDone();
+    m_packPool.waitForDone();
+}
+
+void ThumbnailLoader::cancel() {
+    ++m_generation;
+    m_pool.clear();
+    m_jobs.clear();
+    m_started.clear();
+    m_jobBySlot.clear();
+    m_urgent.clear();
+    m_cursor = 0;
+    m_inFlight = 0;
+    m_inFlightSlots.clear();
+    m_running = false;
+}
+
+void ThumbnailLoader::load(const QList<ThumbnailJob> &jobs) {
+    cancel();
+    m_packHits = 0;
+    m_pngDecodes = 0;
+
+    m_jobs = jobs;
+    m_started.fill(false, m_jobs.size());
+    m_jobBySlot.reserve(m_jobs.size());
+    for (int i = 0; i < m_jobs.size(); ++i) m_jobBySlot.insert(m_jobs[i].index, i);
+
+    if (m_jobs.isEmpty()) {
+        emit finished();
+        return;
+    }
+
+    m_running = true;
+    pump();
+}
+
+void ThumbnailLoader::append(const QList<ThumbnailJob> &jobs) {
+    if (jobs.isEmpty()) return;
+    for (const ThumbnailJob &j : jobs) {
+        m_jobBySlot.insert(j.index, int(m_jobs.size()));
+        m_jobs.append(j);
+        m_started.append(false);
+    }
+    m_running = true;
+    pump();
+}
+
+void ThumbnailLoader::prioritize(const QList<int> &indices) {
+    if (!m_running) return;
+
+    QList<int> urgent;
+    for (int slot : indices) {
+        int job = m_jobBySlot.value(slot, -1);
+        if (job >= 0 && !m_started[job]) urgent.append(job);
+    }
+    if (urgent.isEmpty()) return;
+
+    // newest request first, the viewport has moved on from older ones
+    m_urgent = urgent + m_urgent;
+    pump();
+}
+
+void ThumbnailLoader::requeue(const QList<ThumbnailJob> &jobs) {
+    QList<int> urgent;
+    for (const ThumbnailJob &j : jobs) {
+        if (m_inFlightSlots.contains(j.index)) continue;
+
+        int job = m_jobBySlot.value(j.index, -1);
+        if (job < 0 || m_started[job]) {
+            // done before (and evicted since) or never part of this load
+            job = m_jobs.size();
+            m_jobs.append(j);
+            m_started.append(false);
+            m_jobBySlot.insert(j.index, job);
+        }
+        urgent.append(job);
+    }
+    if (urgent.isEmpty()) return;
+
+    m_urgent = urgent + m_urgent;
+    m_running = true;
+    pump();
+}
+
+void ThumbnailLoader::setBackgroundPaused(bool paused) {
+    if (paused == m_backgroundPaused) return;
+    m_backgroundPaused = paused;
+    if (!paused && m_running) pump();
+}
+
+void ThumbnailLoader::setTier(int tier, const TierLookup &hasTier) {
+    m_tier = tier;
+    m_hasTier = hasTier;
+}
+
+ThumbnailJob ThumbnailLoader::resolveTier(ThumbnailJob job) const {
+    job.tier = TIER_LARGE;
+    if (m_tier == TIER_LARGE || !m_hasTier) return job;
+
+    // scaling down looks better than scaling up, so bigger tiers are tried first
+    QList<int> order;
+    for (int t = m_tier; t < TIER_COUNT; ++t) order.append(t);
+    for (int t = m_tier - 1; t >= 0; --t) order.append(t);
+
+    for (int t : order) {
+        if (t == TIER_LARGE) return job; // known to exist, that's how it got into the grid
+        if (!m_hasTier(t, job.md5)) continue;
+        job.tier = t;
+        job.cachedPath = tierFolder(QFileInfo(job.cachedPath).path(), t) + "/" + QFileInfo(job.cachedPath).fileName();
+        return job;
+    }
+    return job;
+}
+
+void ThumbnailLoader::updatePack(const QList<ThumbnailJob> &library) {
+    if (!m_pack->needsRebuild(library)) return;
+    m_packLibrary = library;
+    if (m_inFlight == 0) startPackBuild();
+}
+
+void ThumbnailLoader::startPackBuild() {
+    if (m_packBuilding) return; // picked up when the running build is done
+    m_packBuilding = true;
+
+    const QList<ThumbnailJob> library = std::exchange(m_packLibrary, {});
+    std::shared_ptr<const ThumbnailPack> old = m_pack;
+
+    // started while the decode threads are idle, later loads run next to it
+    m_packPool.start([this, library, old]() {
+        const bool ok = ThumbnailPack::build(THUMBNAIL_PACK(), old, library, m_packAbort);
+        if (m_packAbort) return;
+
+        QMetaObject::invokeMethod(this, [this, ok]() {
+            m_packBuilding = false;
+            if (ok) {
+                // the old mapping lives on in whatever images still point into it
+                auto pack = std::make_shared<ThumbnailPack>();
+                if (pack->open()) m_pack = pack;
+            }
+            if (!m_packLibrary.isEmpty() && m_inFlight == 0) startPackBuild();
+        }, Qt::QueuedConnection);
+    });
+}
+
+QList<ThumbnailJob> ThumbnailLoader::takeChunk(int maxSize) {
+    QList<ThumbnailJob> chunk;
+
+    while (!m_urgent.isEmpty() && chunk.size() < URGENT_CHUNK_SIZE) {
+        int job = m_urgent.takeFirst();
+        if (m_started[job]) continue;
+        m_started[job] = true;
+        chunk.append(resolveTier(m_jobs[job]));
+    }
+    if (!chunk.isEmpty() || m_backgroundPaused) return chunk;
+
+    while (m_cursor < m_jobs.size() && chunk.size() < maxSize) {
+        int job = m_cursor++;
+        if (m_started[job]) continue;
+        m_started[job] = true;
+        chunk.append(resolveTier(m_jobs[job]));
+    }
+    return chunk;
+}
+
+// Keep a couple of chunks per thread queued, the rest stays on our side so
+// prioritize() can still reorder it
+void ThumbnailLoader::pump() {
+    const int generation = m_generation;
+    const int maxInFlight = m_pool.maxThreadCount() * 2;
+
+    while (m_inFlight < maxInFlight) {
+        QList<ThumbnailJob> chunk = takeChunk(CHUNK_SIZE);
+        if (chunk.isEmpty()) break;
+        ++m_inFlight;
+        for (const ThumbnailJob &job : chunk) m_inFlightSlots.insert(job.index);
+
+        m_pool.start([this, generation, chunk, pack = m_pack]() {
+            QList<ThumbnailJob> done;
+            QList<QImage> images;
+            done.reserve(chunk.size());
+            images.reserve(chunk.size());
+
+            for (const ThumbnailJob &job : chunk) {
+                if (m_generation != generation) return; // superseded, stop early
+
+                // warm start: pixels straight out of the mapped pack, no png involved.
+                // The pack only holds the large tier.
+                QImage img = job.tier == TIER_LARGE ? pack->image(job.md5, job.mtime) : QImage();
+                if (!img.isNull()) {
+                    ++m_packHits;
+                    done.append(job);
+                    images.append(img);
+                    continue;
+                }
+
+                img = QImage(job.cachedPath);
+                if (img.isNull()) {
+                    // truncated or half written png, reported back so the slot isn't left waiting
+                    qDebug() << "Could not decode thumbnail" << job.cachedPath;
+                    done.append(job);
+                    images.append(img);
+                    continue;
+                }
+                ++m_pngDecodes;
+
+                // Pre-convert here so QPixmap::fromImage on the GUI thread is a cheap upload
+                img = img.convertToFormat(img.hasAlphaChannel() ? QImage::Format_ARGB32_Premultiplied
+                                                                : QImage::Format_RGB32);
+                done.append(job);
+                images.append(img);
+            }
+
+            QMetaObject::invokeMethod(this, [this, generation, chunk, done, images]() {
+                onChunkDecoded(generation, chunk, done, images);
+            }, Qt::QueuedConnection);
+        });
+    }
+
+    // paused with library left to walk still counts as running
+    if (m_inFlight == 0 && m_running && (!m_backgroundPaused || m_cursor >= m_jobs.size())) {
+        m_running = false;
+        qDebug() << "Thumbnails loaded:" << int(m_packHits) << "from pack," << int(m_pngDecodes) << "decoded";
+        emit finished();
+    }
+
+    // pack rebuild waits for a quiet moment, it shouldn't compete with the viewport
+    if (m_inFlight == 0 && !m_packLibrary.isEmpty()) startPackBuild();
+}
+
+void ThumbnailLoader::onChunkDecoded(int generation, QList<ThumbnailJob> chunk, QList<ThumbnailJob> jobs, QList<QImage> images) {
+    if (generation != m_generation) return;
+    --m_inFlight;
+    for (const ThumbnailJob &job : chunk) m_inFlightSlots.remove(job.index);
+
+    QList<LoadedThumbnail> batch;
+    batch.reserve(images.size());
+    for (int i = 0; i < images.size(); ++i)
+        batch.append({jobs[i].index, jobs[i].filePath, QPixmap::fromImage(std::move(images[i])), jobs[i].tier});
+
+    if (!batch.isEmpty()) emit batchReady(batch);
+
+    // a slot connected to batchReady may have started a new load
+    if (generation != m_generation) return;
+    pump();
+}
+
+QList<ThumbnailJob> ThumbnailLoader::scanLibrary(const QString &cacheFolder, const QString &mainFolder,
+                                                const ThumbnailCacheSet &cache, QList<ThumbnailJob> *uncached,
+                                                const JobsFn &chunk) {
+    QList<ThumbnailJob> jobs;
+    if (uncached) uncached->clear();
+
+    auto add = [&](const QList<LibraryEntry> &entries) {
+        for (const LibraryEntry &e : entries) {
+            if (e.cached) jobs.append({e.cachedPath(cacheFolder), e.folder, e.filePath, e.thumbSize, int(jobs.size()), e.md5, e.mtime});
+            // stale ones show their old thumbnail until the new one is written
+            if ((!e.cached || e.stale) && uncached)
+                uncached->append({e.cachedPath(cacheFolder), e.folder, e.filePath, QSize(), -1, e.md5, e.mtime});
+        }
+    };
+
+    // entries come in per finished batch of directories, in library order
+    LibraryIndex index;
+    index.refresh(mainFolder, cacheFolder, cache, [&](const QList<LibraryEntry> &entries){
+        const int first = int(jobs.size());
+        add(entries);
+        if (chunk && jobs.size() > first) chunk(jobs.mid(first));
+    });
+
+    // in-place edits only show up in the file stats, the chunks are out by now
+    if (index.checkFiles(cache) > 0) {
+        jobs.clear();
+        if (uncached) uncached->clear();
+        add(index.entries());
+    }
+    if (index.isDirty()) index.save();
+    return jobs;
+}
+
+QList<CachedImage> ThumbnailLoader::placeholders(const QList<ThumbnailJob> &jobs) {
+    QList<CachedImage> images;
+    images.reserve(jobs.size());
+    for (const ThumbnailJob &job : jobs) images.append({QPixmap(), job.folder, job.filePath, job.size, job.mtime});
+    return images;
+}
+
+ThumbnailJob ThumbnailLoader::jobFor(const ThumbnailModel &model, int index, const QString &cacheFolder) {
+    const QByteArray md5 = LibraryIndex::uriMd5(model.filePath(index));
+    const QString cachedPath = cacheFolder + "/" + QString::fromLatin1(md5.toHex()) + ".png";
+    return {cachedPath, model.folderName(index), model.filePath(index), model.thumbSize(index), index, md5,
+            model.mtime(index)};
+}
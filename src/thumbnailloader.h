@@ -0,0 +1,135 @@
+// thumbnailloader.h
+#pragma once
+#include <QObject>
+#include <QHash>
+#include <QImage>
+#include <QList>
+#include <QPixmap>
+#include <QSet>
+#include <QSize>
+#include <QString>
+#include <QThreadPool>
+#include <QVector>
+#include <QByteArray>
+#include <atomic>
+#include <memory>
+#include "cachedimage.h"
+#include "thumbnailmodel.h"
+#include "thumbtiers.h"
+#include <functional>
+
+class ThumbnailCacheSet;
+
+class ThumbnailPack;
+
+// One thumbnail to decode: cached png + the wallpaper it belongs to
+struct ThumbnailJob {
+    QString cachedPath;
+    QString folder;
+    QString filePath;
+    QSize size;         // thumbnail size from the library index, used to reserve its slot
+    int index = -1;     // slot in the grid this thumbnail goes to
+    QByteArray md5;     // raw md5 of the file uri, key into the thumbnail pack
+    qint64 mtime = 0;   // wallpaper mtime, the pack is only used when it's known. -1 to skip it
+    int tier = TIER_LARGE;  // cachedPath is always the large one, the loader picks the tier
+};
+
+struct LoadedThumbnail {
+    int index;
+    QString filePath;   // the slot may have moved on since, check before using it
+    QPixmap pix;        // null if the png couldn't be decoded
+    int tier;
+};
+
+// Decodes cached thumbnails as QImage on worker threads and hands them back
+// to the GUI thread as QPixmap batches tagged with their grid slot.
+// Slots asked for with prioritize() (the ones in the viewport) jump the queue.
+class ThumbnailLoader : public QObject {
+    Q_OBJECT
+public:
+    explicit ThumbnailLoader(QObject *parent = nullptr);
+    ~ThumbnailLoader();
+
+    // Starts a new load, anything still running from a previous load is dropped
+    void load(const QList<ThumbnailJob> &jobs);
+    void cancel();
+    bool isRunning() const { return m_running; }
+
+    // More slots for the background walk, after everything already queued. Starts
+    // a load if none is running, nothing running is dropped
+    void append(const QList<ThumbnailJob> &jobs);
+
+    // Decode these slots next, e.g. the ones intersecting the viewport
+    void prioritize(const QList<int> &indices);
+
+    // Decode these (again) ahead of everything else, e.g. slots whose pixmap was
+    // evicted. Added to the running load, slots already queued or in flight are skipped
+    void requeue(const QList<ThumbnailJob> &jobs);
+
+    // Bring the thumbnail pack in line with the full library. Rebuilt in the
+    // background once the current load is done, and only if something changed
+    void updatePack(const QList<ThumbnailJob> &library);
+
+    // Stop walking the library in the background, only prioritize()/requeue() work is done
+    void setBackgroundPaused(bool paused);
+
+    // Resolution tier to decode from. hasTier says whether a thumbnail exists in
+    // a tier, missing ones fall back to bigger tiers first, then smaller ones
+    using TierLookup = std::function<bool(int tier, const QByteArray &md5)>;
+    void setTier(int tier, const TierLookup &hasTier);
+    int tier() const { return m_tier; }
+
+    // Walk mainFolder and collect every wallpaper that has a cached thumbnail,
+    // job.index is the position in the returned list. Wallpapers still waiting
+    // for a thumbnail, or whose thumbnail is stale, go to uncached if given.
+    // chunk gets the jobs in order as directories are done, before the walk ends.
+    // Files written over in place are only caught after that, the returned list
+    // and uncached have them.
+    using JobsFn = std::function<void(const QList<ThumbnailJob> &jobs)>;
+    static QList<ThumbnailJob> scanLibrary(const QString &cacheFolder, const QString &mainFolder,
+                                           const ThumbnailCacheSet &cache, QList<ThumbnailJob> *uncached = nullptr,
+                                           const JobsFn &chunk = {});
+
+    // Reserved grid slots for jobs, pixmaps are filled in as they are decoded
+    static QList<CachedImage> placeholders(const QList<ThumbnailJob> &jobs);
+
+    // Job to (re)load slot index of model
+    static ThumbnailJob jobFor(const ThumbnailModel &model, int index, const QString &cacheFolder);
+
+signals:
+    // Decoded slots, failed ones included with a null pixmap so they don't wait forever
+    void batchReady(const QList<LoadedThumbnail> &batch);
+    void finished();
+
+private:
+    QThreadPool m_pool;
+    QThreadPool m_packPool;
+    std::atomic<int> m_generation{0};
+    bool m_running = false;
+
+    QList<ThumbnailJob> m_jobs;
+    QVector<bool> m_started;        // per job
+    QHash<int, int> m_jobBySlot;    // grid slot -> job
+    QList<int> m_urgent;            // jobs asked for by prioritize()
+    int m_cursor = 0;               // next job in library order
+    int m_inFlight = 0;
+    QSet<int> m_inFlightSlots;
+    bool m_backgroundPaused = false;
+    int m_tier = TIER_LARGE;
+    TierLookup m_hasTier;
+
+    // Pre-decoded pixels, swapped for a new one after a rebuild
+    std::shared_ptr<ThumbnailPack> m_pack;
+    QList<ThumbnailJob> m_packLibrary;  // waiting for the load to finish
+    bool m_packBuilding = false;
+    std::atomic<bool> m_packAbort{false};
+    std::atomic<int> m_packHits{0};
+    std::atomic<int> m_pngDecodes{0};
+
+    void startPackBuild();
+
+    void pump();
+    QList<ThumbnailJob> takeChunk(int maxSize);
+    ThumbnailJob resolveTier(ThumbnailJob job) const;
+    void onChunkDecoded(int generation, QList<ThumbnailJob> chunk, QList<ThumbnailJob> jobs, QList<QImage> images);
+};
@@ -0,0 +1,75 @@
+// thumbnailmodel.cpp
+#include "thumbnailmodel.h"
+
+float ThumbnailModel::aspectOf(const QSize &size) {
+    if (size.width() <= 0 || size.height() <= 0) return 0.0f;
+    return float(size.width()) / float(size.height());
+}
+
+quint32 ThumbnailModel::internFolder(const QString &name) {
+    auto it = m_folderIdByName.constFind(name);
+    if (it != m_folderIdByName.constEnd()) return it.value();
+
+    const quint32 id = quint32(m_folders.size());
+    m_folders.append(name);
+    m_folderIdByName.insert(name, id);
+    return id;
+}
+
+void ThumbnailModel::assign(const QList<CachedImage> &images) {
+    const int n = int(images.size());
+    m_folderIds.resize(n);
+    m_aspects.resize(n);
+    m_paths.resize(n);
+    m_sizes.resize(n);
+    m_mtimes.resize(n);
+    m_pixmaps.resize(n);
+    m_folders.clear();
+    m_folderIdByName.clear();
+
+    for (int i = 0; i < n; ++i) {
+        const CachedImage &img = images[i];
+        const QSize size = img.pix.isNull() ? img.size : img.pix.size();
+        m_folderIds[i] = internFolder(img.folder);
+        m_aspects[i] = aspectOf(size);
+        m_paths[i] = img.filePath;
+        m_sizes[i] = size;
+        m_mtimes[i] = img.mtime;
+        m_pixmaps[i] = img.pix;
+    }
+    ++m_version;
+}
+
+void ThumbnailModel::append(const QList<CachedImage> &images) {
+    for (const CachedImage &img : images) {
+        const QSize size = img.pix.isNull() ? img.size : img.pix.size();
+        m_folderIds.append(internFolder(img.folder));
+        m_aspects.append(aspectOf(size));
+        m_paths.append(img.filePath);
+        m_sizes.append(size);
+        m_mtimes.append(img.mtime);
+        m_pixmaps.append(img.pix);
+    }
+    ++m_version;
+}
+
+QList<CachedImage> ThumbnailModel::toList() const {
+    QList<CachedImage> images;
+    images.reserve(size());
+    for (int i = 0; i < size(); ++i) images.append({m_pixmaps[i], folderName(i), m_paths[i], m_sizes[i], m_mtimes[i]});
+    return images;
+}
+
+void ThumbnailModel::setPixmap(int i, const QPixmap &pix) {
+    m_pixmaps[i] = pix;
+    if (pix.isNull() || pix.size() == m_sizes[i]) return;
+
+    // another resolution tier of the same shape, nothing moves
+    const float aspect = aspectOf(pix.size());
+    if (m_aspects[i] > 0.0f && qAbs(aspect - m_aspects[i]) <= m_aspects[i] * 0.01f) return;
+
+    // the index didn't know the real size, layout has to follow
+    m_sizes[i] = pix.size();
+    m_aspects[i] = aspect;
+    ++m_version;
+}
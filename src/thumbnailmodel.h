@@ -0,0 +1,60 @@
+// thumbnailmodel.h
+#pragma once
+#include <QHash>
+#include <QList>
+#include <QPixmap>
+#include <QSize>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include "cachedimage.h"
+
+// The grid's thumbnails as parallel arrays. Layout and hit-testing only walk
+// the small numeric ones (folder ids, aspect ratios), paths and pixmaps sit
+// in their own arrays and are only touched for the slots actually drawn.
+// CachedImage stays the format used to hand lists to and from the model.
+class ThumbnailModel {
+public:
+    int size() const { return int(m_paths.size()); }
+    bool isEmpty() const { return m_paths.isEmpty(); }
+
+    void assign(const QList<CachedImage> &images);
+    // More slots after the last one, e.g. the library scan streaming in
+    void append(const QList<CachedImage> &images);
+    QList<CachedImage> toList() const;
+
+    // Hot data
+    const QVector<quint32> &folderIds() const { return m_folderIds; }
+    const QVector<float> &aspects() const { return m_aspects; }   // width / height, 0 if unknown
+
+    // Cold data
+    const QString &filePath(int i) const { return m_paths[i]; }
+    const QString &folderName(int i) const { return m_folders[m_folderIds[i]]; }
+    QSize thumbSize(int i) const { return m_sizes[i]; }
+    qint64 mtime(int i) const { return m_mtimes[i]; }
+    const QPixmap &pixmap(int i) const { return m_pixmaps[i]; }
+    bool hasPixmap(int i) const { return !m_pixmaps[i].isNull(); }
+
+    // Store a decoded pixmap (any tier), the layout is redone if its shape wasn't known
+    void setPixmap(int i, const QPixmap &pix);
+    // Drop a pixmap but keep the slot (and its size) where it is
+    void dropPixmap(int i) { m_pixmaps[i] = QPixmap(); }
+
+    // Bumped whenever something the layout reads changes
+    quint64 version() const { return m_version; }
+
+private:
+    QVector<quint32> m_folderIds;
+    QVector<float> m_aspects;
+    QVector<QString> m_paths;
+    QVector<QSize> m_sizes;
+    QVector<qint64> m_mtimes;
+    QVector<QPixmap> m_pixmaps;
+
+    QStringList m_folders;                  // folder id -> name
+    QHash<QString, quint32> m_folderIdByName;
+    quint64 m_version = 0;
+
+    quint32 internFolder(const QString &name);
+    static float aspectOf(const QSize &size);
+};
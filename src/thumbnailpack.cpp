@@ -0,0 +1,209 @@
+// thumbnailpack.cpp
+#include "thumbnailpack.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QDebug>
+#include <algorithm>
+#include <cstring>
+
+// -------------------------------
+// On-disk layout
+// -------------------------------
+// header | PackRecord[count], sorted by md5 | pixel data, each image 64-byte aligned
+// Bump PACK_VERSION whenever any of the records below change.
+
+static const char PACK_MAGIC[4] = {'Q', 'H', 'P', 'T'};
+static const quint32 PACK_VERSION = 2;   // 2: input digest
+static const qint64 PIXEL_ALIGN = 64;
+
+struct PackHeader {
+    char magic[4];
+    quint32 version;
+    quint32 count;
+    quint32 reserved;
+    quint64 tableOffset;
+    quint64 inputDigest;    // of the library build() was given, see digestOf()
+};
+
+struct PackRecord {
+    quint8 md5[16];
+    qint64 mtime;       // source wallpaper mtime the pixels belong to, ns
+    quint64 offset;
+    quint32 width;
+    quint32 height;
+    quint32 bytesPerLine;
+    quint32 format;     // QImage::Format
+};
+
+static_assert(sizeof(PackHeader) == 32, "pack header layout changed");
+static_assert(sizeof(PackRecord) == 48, "pack record layout changed");
+
+// One job per md5 in md5 order, the way build() walks them
+static void sortKeys(QList<ThumbnailJob> &library) {
+    std::sort(library.begin(), library.end(), [](const ThumbnailJob &a, const ThumbnailJob &b) {
+        return a.md5 < b.md5;
+    });
+    library.erase(std::unique(library.begin(), library.end(), [](const ThumbnailJob &a, const ThumbnailJob &b) {
+        return a.md5 == b.md5;
+    }), library.end());
+}
+
+// FNV-1a over md5 + mtime of sorted keys. Thumbnails build() had to skip
+// (undecodable png, bad md5) are in here too, so they don't look like a
+// library change on every launch
+static quint64 digestOf(const QList<ThumbnailJob> &sorted) {
+    quint64 h = 14695981039346656037ull;
+    auto mix = [&h](const void *data, size_t size) {
+        const uchar *p = static_cast<const uchar *>(data);
+        for (size_t i = 0; i < size; ++i) {
+            h ^= p[i];
+            h *= 1099511628211ull;
+        }
+    };
+    for (const ThumbnailJob &job : sorted) {
+        mix(job.md5.constData(), size_t(job.md5.size()));
+        mix(&job.mtime, sizeof job.mtime);
+    }
+    return h;
+}
+
+static qint64 alignUp(qint64 v) {
+    return (v + PIXEL_ALIGN - 1) / PIXEL_ALIGN * PIXEL_ALIGN;
+}
+
+ThumbnailPack::ThumbnailPack(const QString &packPath)
+    : m_path(packPath), m_file(packPath)
+{
+}
+
+bool ThumbnailPack::open() {
+    if (!m_file.open(QIODevice::ReadOnly)) return false;
+
+    m_size = m_file.size();
+    if (m_size < qint64(sizeof(PackHeader))) return false;
+
+    m_base = m_file.map(0, m_size);
+    if (!m_base) return false;
+
+    PackHeader h;
+    std::memcpy(&h, m_base, sizeof h);
+    if (std::memcmp(h.magic, PACK_MAGIC, 4) != 0 || h.version != PACK_VERSION ||
+        h.tableOffset + quint64(h.count) * sizeof(PackRecord) > quint64(m_size)) {
+        qDebug() << "Thumbnail pack" << m_path << "is stale or damaged, ignoring it";
+        return false;
+    }
+
+    m_count = h.count;
+    m_inputDigest = h.inputDigest;
+    m_records = reinterpret_cast<const PackRecord *>(m_base + h.tableOffset);
+    return true;
+}
+
+const PackRecord *ThumbnailPack::find(const QByteArray &md5) const {
+    if (!m_records || md5.size() != 16) return nullptr;
+
+    const PackRecord *end = m_records + m_count;
+    const PackRecord *it = std::lower_bound(m_records, end, md5, [](const PackRecord &r, const QByteArray &key) {
+        return std::memcmp(r.md5, key.constData(), 16) < 0;
+    });
+    if (it == end || std::memcmp(it->md5, md5.constData(), 16) != 0) return nullptr;
+    return it;
+}
+
+static void releasePack(void *info) {
+    delete static_cast<std::shared_ptr<const ThumbnailPack> *>(info);
+}
+
+QImage ThumbnailPack::image(const QByteArray &md5, qint64 mtime) const {
+    const PackRecord *r = find(md5);
+    if (!r || mtime <= 0 || r->mtime != mtime) return QImage();
+    if (r->offset + quint64(r->height) * r->bytesPerLine > quint64(m_size)) return QImage();
+
+    // read-only QImage over the mapping, it holds a reference to us until it's released
+    auto *keep = new std::shared_ptr<const ThumbnailPack>(shared_from_this());
+    return QImage(m_base + r->offset, int(r->width), int(r->height), qsizetype(r->bytesPerLine),
+                  QImage::Format(r->format), releasePack, keep);
+}
+
+bool ThumbnailPack::needsRebuild(const QList<ThumbnailJob> &library) const {
+    if (!isOpen()) return !library.isEmpty();
+
+    // what went into the last build, not what came out of it
+    QList<ThumbnailJob> keys = library;
+    sortKeys(keys);
+    return digestOf(keys) != m_inputDigest;
+}
+
+bool ThumbnailPack::build(const QString &packPath, std::shared_ptr<const ThumbnailPack> old,
+                          QList<ThumbnailJob> library, const std::atomic<bool> &abort) {
+    // table is binary searched, so sorted by md5 and one record per md5
+    sortKeys(library);
+
+    QDir().mkpath(QFileInfo(packPath).absolutePath());
+    QSaveFile f(packPath);
+    if (!f.open(QIODevice::WriteOnly)) {
+        qWarning() << "Failed to write" << packPath;
+        return false;
+    }
+
+    // table space up front, filled in once we know what made it in
+    const qint64 tableOffset = sizeof(PackHeader);
+    qint64 pos = tableOffset + qint64(library.size()) * sizeof(PackRecord);
+    f.write(QByteArray(pos, '\0'));
+
+    QList<PackRecord> records;
+    records.reserve(library.size());
+    int copied = 0;
+
+    for (const ThumbnailJob &job : library) {
+        if (abort) {
+            f.cancelWriting();
+            return false;
+        }
+        if (job.md5.size() != 16) continue;
+
+        QImage img = old ? old->image(job.md5, job.mtime) : QImage();
+        if (!img.isNull()) {
+            ++copied;
+        } else {
+            img = QImage(job.cachedPath);
+            if (img.isNull()) continue;
+            img = img.convertToFormat(img.hasAlphaChannel() ? QImage::Format_ARGB32_Premultiplied
+                                                            : QImage::Format_RGB32);
+        }
+
+        const qint64 at = alignUp(pos);
+        if (at > pos) f.write(QByteArray(at - pos, '\0'));
+
+        PackRecord r{};
+        std::memcpy(r.md5, job.md5.constData(), 16);
+        r.mtime = job.mtime;
+        r.offset = quint64(at);
+        r.width = quint32(img.width());
+        r.height = quint32(img.height());
+        r.bytesPerLine = quint32(img.bytesPerLine());
+        r.format = quint32(img.format());
+        records.append(r);
+
+        f.write(reinterpret_cast<const char *>(img.constBits()), img.sizeInBytes());
+        pos = at + img.sizeInBytes();
+    }
+
+    PackHeader h{};
+    std::memcpy(h.magic, PACK_MAGIC, 4);
+    h.version = PACK_VERSION;
+    h.count = quint32(records.size());
+    h.tableOffset = quint64(tableOffset);
+    h.inputDigest = digestOf(library);
+
+    f.seek(0);
+    f.write(reinterpret_cast<const char *>(&h), sizeof h);
+    f.write(reinterpret_cast<const char *>(records.constData()), records.size() * sizeof(PackRecord));
+    if (!f.commit()) return false;
+
+    qDebug() << "Thumbnail pack rebuilt:" << records.size() << "thumbnails," << copied << "reused,"
+             << (records.size() - copied) << "decoded," << (library.size() - records.size()) << "skipped,"
+             << (pos >> 20) << "MiB";
+    return true;
+}
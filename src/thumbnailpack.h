@@ -0,0 +1,53 @@
+// thumbnailpack.h
+#pragma once
+#include <QByteArray>
+#include <QFile>
+#include <QImage>
+#include <QList>
+#include <atomic>
+#include <memory>
+#include "paths.h"
+#include "thumbnailloader.h"
+
+struct PackRecord;
+
+// Our own cache of already decoded thumbnails: one file with an md5-sorted
+// offset table followed by raw ARGB32/RGB32 pixels. It is memory-mapped and
+// images are handed out as QImages pointing straight into the mapping, so a
+// warm start neither opens nor decodes any png.
+// The pixels are the "large" tier as is, not scaled to the grid: they stand in
+// for the png at any zoom, display sizes come from ScaledPixmapCache.
+class ThumbnailPack : public std::enable_shared_from_this<ThumbnailPack> {
+public:
+    explicit ThumbnailPack(const QString &packPath = THUMBNAIL_PACK());
+
+    // Map the file, false if it's missing or not a pack we understand
+    bool open();
+    bool isOpen() const { return m_records != nullptr; }
+    int count() const { return int(m_count); }
+
+    // Pixels stored for md5 made from the wallpaper at mtime, null if there are
+    // none (an unknown mtime never matches). The image keeps the mapping alive
+    // until it (and any pixmap sharing it) is gone, so it stays valid across a rebuild.
+    QImage image(const QByteArray &md5, qint64 mtime) const;
+
+    // library isn't what the pack was last built from: wallpapers added, lost
+    // or changed since. Ones build() couldn't decode don't count as missing
+    bool needsRebuild(const QList<ThumbnailJob> &library) const;
+
+    // Write a fresh pack for library. Pixels still valid in old are copied over,
+    // only the rest is decoded from the thumbnail cache. Safe on a worker thread.
+    static bool build(const QString &packPath, std::shared_ptr<const ThumbnailPack> old,
+                      QList<ThumbnailJob> library, const std::atomic<bool> &abort);
+
+private:
+    QString m_path;
+    QFile m_file;
+    const uchar *m_base = nullptr;
+    qint64 m_size = 0;
+    quint32 m_count = 0;
+    quint64 m_inputDigest = 0;
+    const PackRecord *m_records = nullptr;
+
+    const PackRecord *find(const QByteArray &md5) const;
+};
@@ -0,0 +1,122 @@
+// thumbnailresidency.cpp
+#include "thumbnailresidency.h"
+#include <QDebug>
+
+static qint64 s_defaultBudget = 512LL * 1024 * 1024;
+
+// Screens kept decoded ahead in the scroll direction, and behind it
+static const int PREFETCH_AHEAD = 2;
+static const int PREFETCH_BEHIND = 1;
+// Evict down to this fraction of the budget, so one new row doesn't evict again
+static const qreal EVICT_TARGET = 0.9;
+
+ThumbnailResidency::ThumbnailResidency(const QString &cacheFolder, QObject *parent)
+    : QObject(parent), m_cacheFolder(cacheFolder), m_budget(s_defaultBudget)
+{
+}
+
+void ThumbnailResidency::setDefaultBudget(qint64 bytes) {
+    s_defaultBudget = qMax<qint64>(bytes, 16LL * 1024 * 1024);
+}
+
+qint64 ThumbnailResidency::bytesOf(const QPixmap &pix) {
+    return qint64(pix.width()) * pix.height() * qMax(pix.depth(), 8) / 8;
+}
+
+void ThumbnailResidency::reset(const ThumbnailModel &model) {
+    m_residentBytes = 0;
+    for (int i = 0; i < model.size(); ++i) m_residentBytes += bytesOf(model.pixmap(i));
+    m_requested.clear();
+    m_failed.clear();
+    m_lastFirst = -1;
+}
+
+void ThumbnailResidency::loaded(int index, const QPixmap &pix) {
+    m_residentBytes += bytesOf(pix);
+    m_requested.remove(index);
+}
+
+void ThumbnailResidency::replaced(int index, const QPixmap &old, const QPixmap &pix) {
+    m_residentBytes -= bytesOf(old);
+    loaded(index, pix);
+}
+
+void ThumbnailResidency::dropped(int index, const QPixmap &old) {
+    m_residentBytes -= bytesOf(old);
+    m_requested.remove(index);
+}
+
+void ThumbnailResidency::failed(int index) {
+    m_requested.remove(index);
+    m_failed.insert(index);
+}
+
+bool ThumbnailResidency::retry(int index) {
+    return m_failed.remove(index);
+}
+
+void ThumbnailResidency::update(ThumbnailModel &model, int firstVisible, int lastVisible) {
+    if (model.isEmpty() || firstVisible < 0 || lastVisible < firstVisible) return;
+
+    if (m_lastFirst >= 0 && firstVisible != m_lastFirst) m_direction = firstVisible > m_lastFirst ? 1 : -1;
+    m_lastFirst = firstVisible;
+
+    // window around the viewport, stretched in the scroll direction
+    const int screen = lastVisible - firstVisible + 1;
+    const int ahead = screen * PREFETCH_AHEAD;
+    const int behind = screen * PREFETCH_BEHIND;
+    const int windowFirst = qMax(0, firstVisible - (m_direction > 0 ? behind : ahead));
+    const int windowLast = qMin(model.size() - 1, lastVisible + (m_direction > 0 ? ahead : behind));
+
+    if (m_residentBytes > m_budget) evict(model, windowFirst, windowLast);
+
+    // visible first, then outwards in the scroll direction
+    QList<ThumbnailJob> jobs;
+    auto want = [&](int i) {
+        if (model.hasPixmap(i) || m_requested.contains(i) || m_failed.contains(i)) return;
+        m_requested.insert(i);
+        jobs.append(ThumbnailLoader::jobFor(model, i, m_cacheFolder));
+    };
+    for (int i = firstVisible; i <= lastVisible && i < model.size(); ++i) want(i);
+    if (m_direction > 0) {
+        for (int i = lastVisible + 1; i <= windowLast; ++i) want(i);
+        for (int i = firstVisible - 1; i >= windowFirst; --i) want(i);
+    } else {
+        for (int i = firstVisible - 1; i >= windowFirst; --i) want(i);
+        for (int i = lastVisible + 1; i <= windowLast; ++i) want(i);
+    }
+    if (!jobs.isEmpty()) emit reloadRequested(jobs);
+
+    // stop at the eviction target, or the background walk refills what we just evicted
+    const bool paused = m_residentBytes >= qint64(m_budget * EVICT_TARGET);
+    if (paused != m_paused) {
+        m_paused = paused;
+        emit backgroundPaused(paused);
+    }
+}
+
+void ThumbnailResidency::evict(ThumbnailModel &model, int windowFirst, int windowLast) {
+    const qint64 target = qint64(m_budget * EVICT_TARGET);
+    const qint64 before = m_residentBytes;
+    const quint64 evictionsBefore = m_evictions;
+
+    // farthest from the window first, taking from whichever end is farther away
+    int lo = 0;
+    int hi = model.size() - 1;
+    while (m_residentBytes > target && (lo < windowFirst || hi > windowLast)) {
+        int i;
+        if (lo >= windowFirst) i = hi--;
+        else if (hi <= windowLast) i = lo++;
+        else i = (windowFirst - lo >= hi - windowLast) ? lo++ : hi--;
+
+        if (!model.hasPixmap(i)) continue;
+        m_residentBytes -= bytesOf(model.pixmap(i));
+        model.dropPixmap(i);
+        m_requested.remove(i);
+        ++m_evictions;
+    }
+
+    qDebug() << "Thumbnail residency:" << (before >> 20) << "->" << (m_residentBytes >> 20) << "MiB of"
+             << (m_budget >> 20) << "MiB, evicted" << (m_evictions - evictionsBefore)
+             << "this pass," << m_evictions << "total";
+}
@@ -0,0 +1,62 @@
+// thumbnailresidency.h
+#pragma once
+#include <QObject>
+#include <QList>
+#include <QSet>
+#include <QString>
+#include "thumbnailmodel.h"
+#include "thumbnailloader.h"
+
+// Keeps the decoded thumbnails of a grid within a byte budget. Pixmaps far
+// from the viewport are dropped (their slot stays, so the layout doesn't move)
+// and asked for again once they come close, with extra prefetch in the
+// direction the user is scrolling.
+class ThumbnailResidency : public QObject {
+    Q_OBJECT
+public:
+    explicit ThumbnailResidency(const QString &cacheFolder, QObject *parent = nullptr);
+
+    // Budget for every residency created afterwards, from the settings
+    static void setDefaultBudget(qint64 bytes);
+
+    // Model was replaced or shifted, recount what is resident
+    void reset(const ThumbnailModel &model);
+    // A decoded pixmap just landed in slot index
+    void loaded(int index, const QPixmap &pix);
+    // ...replacing one from another resolution tier
+    void replaced(int index, const QPixmap &old, const QPixmap &pix);
+    // Slot index let go of old, e.g. to load a regenerated thumbnail
+    void dropped(int index, const QPixmap &old);
+    // Slot index couldn't be decoded, it isn't asked for again until retry()
+    void failed(int index);
+    // A new thumbnail for index was written, true if it had failed before
+    bool retry(int index);
+
+    // Call with the slots in view after each layout/scroll: evicts down to the
+    // budget and requests whatever is missing around the viewport
+    void update(ThumbnailModel &model, int firstVisible, int lastVisible);
+
+    qint64 residentBytes() const { return m_residentBytes; }
+    qint64 budget() const { return m_budget; }
+    quint64 evictions() const { return m_evictions; }
+
+signals:
+    // Slots to decode (again), ahead of the background walk
+    void reloadRequested(const QList<ThumbnailJob> &jobs);
+    // Budget full: the loader should only do what is asked for
+    void backgroundPaused(bool paused);
+
+private:
+    QString m_cacheFolder;
+    qint64 m_budget;
+    qint64 m_residentBytes = 0;
+    quint64 m_evictions = 0;
+    QSet<int> m_requested;      // reloads sent and not landed yet
+    QSet<int> m_failed;         // decode failed, left as placeholders
+    int m_lastFirst = -1;
+    int m_direction = 1;        // +1 scrolling down, -1 up
+    bool m_paused = false;
+
+    static qint64 bytesOf(const QPixmap &pix);
+    void evict(ThumbnailModel &model, int windowFirst, int windowLast);
+};
@@ -0,0 +1,24 @@
+// thumbtiers.h
+#pragma once
+#include <QFileInfo>
+#include <QString>
+
+// The freedesktop thumbnail sizes, each in its own folder next to "large"
+enum ThumbTier { TIER_NORMAL, TIER_LARGE, TIER_XLARGE, TIER_XXLARGE, TIER_COUNT };
+
+inline int tierSize(int tier) {
+    static const int sizes[TIER_COUNT] = {128, 256, 512, 1024};
+    return sizes[tier];
+}
+
+inline QString tierFolder(const QString &largeFolder, int tier) {
+    static const char *names[TIER_COUNT] = {"normal", "large", "x-large", "xx-large"};
+    return QFileInfo(largeFolder).path() + "/" + names[tier];
+}
+
+// Smallest tier that is at least pixelHeight tall, the biggest one past that
+inline ThumbTier tierFor(int pixelHeight) {
+    for (int t = 0; t < TIER_COUNT; ++t)
+        if (tierSize(t) >= pixelHeight) return ThumbTier(t);
+    return TIER_XXLARGE;
+}
@@ -0,0 +1,437 @@
+// wallpaperapplier.cpp
+#include "wallpaperapplier.h"
+#include "reload.h"
+#include <QImageReader>
+#include <QSet>
+#include <utility>
+#include <QDebug>
+
+// Speculation defaults, main() overrides them from the settings
+static bool s_speculate = false;
+static int s_dwellMs = 350;
+static int s_maxSpeculative = 3;
+static qint64 s_maxSpeculativeBytes = 1024LL * 1024 * 1024;
+
+// hyprpaper keeps the whole image decoded, 4 bytes a pixel. Header only, no decode
+static qint64 decodedBytes(const QString &filePath) {
+    const QSize size = QImageReader(filePath).size();
+    return size.isValid() ? qint64(size.width()) * size.height() * 4 : 0;
+}
+
+void WallpaperApplier::setSpeculation(bool enabled, int dwellMs, int maxImages, qint64 maxBytes) {
+    s_speculate = enabled;
+    s_dwellMs = qMax(0, dwellMs);
+    s_maxSpeculative = qMax(1, maxImages);
+    s_maxSpeculativeBytes = qMax<qint64>(0, maxBytes);
+}
+
+WallpaperApplier::WallpaperApplier(QObject *parent)
+    : QObject(parent),
+      m_speculate(s_speculate),
+      m_maxSpeculative(s_maxSpeculative),
+      m_maxSpeculativeBytes(s_maxSpeculativeBytes)
+{
+    // a click's send next to every speculative preload, startBatch() adds one
+    // per monitor so a slow one doesn't hold up the others
+    m_pool.setMaxThreadCount(m_maxSpeculative + 1);
+
+    m_dwell.setSingleShot(true);
+    m_dwell.setInterval(s_dwellMs);
+    connect(&m_dwell, &QTimer::timeout, this, &WallpaperApplier::speculate);
+}
+
+WallpaperApplier::~WallpaperApplier() {
+    m_pool.waitForDone();
+}
+
+bool WallpaperApplier::isBusy(const QString &monitor) const {
+    auto it = m_monitors.constFind(monitor);
+    return it != m_monitors.constEnd() && !it->inFlight.isEmpty();
+}
+
+void WallpaperApplier::apply(const QString &monitor, const QString &filePath) {
+    if (monitor.isEmpty() || filePath.isEmpty()) return;
+    Monitor &m = m_monitors[monitor];
+
+    // newer than the batch still waiting for this monitor, it drops out of it
+    if (m_pendingBatch.contains(monitor)) emit applySuperseded(monitor, m_pendingBatch.take(monitor));
+
+    if (m.inFlight.isEmpty()) {
+        start(monitor, filePath);
+        return;
+    }
+    if (filePath == m.inFlight) {
+        // clicked the one already on its way, forget whatever came in between
+        // and make it current again
+        if (!m.pending.isEmpty()) emit applySuperseded(monitor, m.pending);
+        m.pending.clear();
+        *m.generation = m.inFlightGeneration;
+        return;
+    }
+
+    // latest wins: replaces whatever was waiting, and tells the running one it's stale
+    if (!m.pending.isEmpty() && m.pending != filePath) emit applySuperseded(monitor, m.pending);
+    m.pending = filePath;
+    ++*m.generation;
+}
+
+void WallpaperApplier::start(const QString &monitor, const QString &filePath) {
+    Monitor &m = m_monitors[monitor];
+    m.inFlight = filePath;
+    m.pending.clear();
+    emit applyStarted(monitor, filePath);
+
+    auto it = m_speculative.find(filePath);
+    if (it == m_speculative.end()) {
+        send(monitor, filePath, true);
+        return;
+    }
+
+    if (!it->loaded) {
+        // hover got it going already, the wallpaper goes out once it's in
+        m.inFlightGeneration = ++*m.generation;
+        ++m_stats.lateHits;
+        m_stats.savedMs += it->clock.elapsed();
+        it->waiting.append(monitor);
+        return;
+    }
+
+    // already in hyprpaper, only "wallpaper" left to send
+    ++m_stats.hits;
+    m_stats.savedMs += it->loadMs;
+    m_speculative.erase(it);
+    send(monitor, filePath, false);
+}
+
+void WallpaperApplier::send(const QString &monitor, const QString &filePath, bool preload) {
+    Monitor &m = m_monitors[monitor];
+    const int generation = ++*m.generation;
+    m.inFlightGeneration = generation;
+    const bool keep = m_speculate;
+
+    m_pool.start([this, monitor, filePath, preload, generation, counter = m.generation, keep]() {
+        QString error;
+        int outcome = Failed;
+        qint64 keptBytes = 0;
+        if (!preload || preloadWallpaper(filePath, error)) {
+            if (*counter != generation) {
+                // clicked away while it was loading, don't flash it on screen. Whether
+                // it gets unloaded is up to onDone, other monitors may want it by now
+                if (keep) keptBytes = qMax<qint64>(1, decodedBytes(filePath));
+                outcome = Cancelled;
+            } else if (setWallpaper(monitor, filePath, error)) {
+                outcome = Applied;
+            }
+        }
+        QMetaObject::invokeMethod(this, [this, monitor, filePath, outcome, error, keptBytes]() {
+            onDone(monitor, filePath, outcome, error, keptBytes);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void WallpaperApplier::onDone(const QString &monitor, const QString &filePath, int outcome, const QString &error, qint64 keptBytes) {
+    Monitor &m = m_monitors[monitor];
+    const bool current = *m.generation == m.inFlightGeneration;
+    m.inFlight.clear();
+
+    if (outcome == Cancelled && current && m.pending.isEmpty()) {
+        // clicked again after the worker gave up on it, it's still preloaded
+        m.inFlight = filePath;
+        send(monitor, filePath, false);
+        return;
+    }
+
+    switch (outcome) {
+    case Applied:
+        m_active.insert(monitor, filePath);
+        m_speculative.remove(filePath);
+        emit applied(monitor, filePath);
+        break;
+    case Failed:
+        qWarning() << "Setting" << filePath << "on" << monitor << "failed:" << error;
+        emit applyFailed(monitor, filePath, error);
+        break;
+    case Cancelled:
+        // with speculation on it stays loaded in case it gets clicked again,
+        // otherwise it goes unless some monitor shows it or is about to
+        if (keptBytes > 0) keepSpeculative(filePath, keptBytes);
+        else if (!m_speculate && !inUse(filePath)) m_pool.start([filePath]() { unloadWallpaper(filePath); });
+        emit applySuperseded(monitor, filePath);
+        break;
+    }
+
+    if (!m.pending.isEmpty()) start(monitor, m.pending);
+    else startPendingBatch();
+}
+
+// -------------------------------
+// Batches
+// -------------------------------
+
+void WallpaperApplier::applyBatch(const QHash<QString, QString> &assignments) {
+    // a newer batch replaces one still waiting, and any click waiting on its monitors
+    for (auto it = m_pendingBatch.cbegin(); it != m_pendingBatch.cend(); ++it) {
+        if (assignments.value(it.key()) != it.value()) emit applySuperseded(it.key(), it.value());
+    }
+    m_pendingBatch.clear();
+
+    bool idle = true;
+    for (auto it = assignments.cbegin(); it != assignments.cend(); ++it) {
+        if (it.key().isEmpty() || it.value().isEmpty()) continue;
+        Monitor &m = m_monitors[it.key()];
+        if (!m.pending.isEmpty()) emit applySuperseded(it.key(), m.pending);
+        m.pending.clear();
+        if (!m.inFlight.isEmpty()) {
+            ++*m.generation;    // tells the running one it's stale
+            idle = false;
+        }
+        m_pendingBatch.insert(it.key(), it.value());
+    }
+
+    // waits for the monitors that are busy, otherwise they wouldn't switch together
+    if (idle) startPendingBatch();
+}
+
+void WallpaperApplier::startPendingBatch() {
+    if (m_pendingBatch.isEmpty()) return;
+    for (auto it = m_pendingBatch.cbegin(); it != m_pendingBatch.cend(); ++it) {
+        if (isBusy(it.key())) return;
+    }
+    startBatch(std::exchange(m_pendingBatch, {}));
+}
+
+void WallpaperApplier::startBatch(const QHash<QString, QString> &assignments) {
+    auto batch = std::make_shared<Batch>();
+    batch->clock.start();
+
+    // every monitor's wallpaper goes out at the same moment, idle threads expire on their own
+    m_pool.setMaxThreadCount(qMax(m_pool.maxThreadCount(), int(assignments.size()) + m_maxSpeculative));
+
+    for (auto it = assignments.cbegin(); it != assignments.cend(); ++it) {
+        Monitor &m = m_monitors[it.key()];
+        m.inFlight = it.value();
+        m.pending.clear();
+        Batch::Entry e;
+        e.monitor = it.key();
+        e.filePath = it.value();
+        e.generation = ++*m.generation;
+        m.inFlightGeneration = e.generation;
+        batch->entries.append(e);
+        emit applyStarted(it.key(), it.value());
+    }
+
+    // one preload per wallpaper no matter how many monitors get it, none for
+    // the ones a hover already loaded
+    QStringList preloads;
+    for (const Batch::Entry &e : batch->entries) {
+        if (batch->preloadErrors.contains(e.filePath)) continue;
+        batch->preloadErrors.insert(e.filePath, QString());
+
+        auto spec = m_speculative.find(e.filePath);
+        if (spec != m_speculative.end() && spec->loaded) {
+            ++m_stats.hits;
+            m_stats.savedMs += spec->loadMs;
+            m_speculative.erase(spec);
+            continue;
+        }
+        preloads.append(e.filePath);
+    }
+
+    qDebug() << "Batch of" << batch->entries.size() << "monitors," << preloads.size() << "preloads";
+    batch->waiting = preloads.size();
+    if (preloads.isEmpty()) {
+        batchPreloaded(batch);
+        return;
+    }
+
+    // all in parallel, hyprpaper decodes them side by side
+    for (const QString &filePath : preloads) {
+        m_pool.start([this, batch, filePath]() {
+            QString error;
+            if (!preloadWallpaper(filePath, error) && error.isEmpty()) error = "no reply";
+            QMetaObject::invokeMethod(this, [this, batch, filePath, error]() {
+                batch->preloadErrors.insert(filePath, error);
+                if (--batch->waiting == 0) batchPreloaded(batch);
+            }, Qt::QueuedConnection);
+        });
+    }
+}
+
+void WallpaperApplier::batchPreloaded(const std::shared_ptr<Batch> &batch) {
+    batch->preloadMs = batch->clock.elapsed();
+
+    QSet<QString> used;
+
+    QList<int> sends;
+    for (int i = 0; i < batch->entries.size(); ++i) {
+        Batch::Entry &e = batch->entries[i];
+        const QString error = batch->preloadErrors.value(e.filePath);
+        if (!error.isEmpty()) {
+            e.outcome = Failed;
+            e.error = error;
+        } else if (*m_monitors[e.monitor].generation != e.generation) {
+            e.outcome = Cancelled;  // clicked away while preloading
+        } else {
+            sends.append(i);
+            used.insert(e.filePath);
+        }
+    }
+
+    // preloaded for nobody after all: kept for later with speculation on, the
+    // rest is unloaded by onDone once no monitor wants it any more
+    for (Batch::Entry &e : batch->entries) {
+        if (e.outcome == Cancelled && m_speculate && !used.contains(e.filePath)) e.keep = true;
+    }
+
+    batch->waiting = sends.size();
+    if (sends.isEmpty()) {
+        batchDone(batch);
+        return;
+    }
+
+    // every "wallpaper" at once on its own connection, hyprpaper answers one
+    // request per connection so this is as close to one round trip as it gets
+    for (int i : sends) {
+        const QString monitor = batch->entries[i].monitor;
+        const QString filePath = batch->entries[i].filePath;
+        m_pool.start([this, batch, i, monitor, filePath]() {
+            QString error;
+            const int outcome = setWallpaper(monitor, filePath, error) ? Applied : Failed;
+            QMetaObject::invokeMethod(this, [this, batch, i, outcome, error]() {
+                Batch::Entry &e = batch->entries[i];
+                e.outcome = outcome;
+                e.error = error;
+                const qint64 ms = batch->clock.elapsed();
+                if (batch->firstSetMs < 0) batch->firstSetMs = ms;
+                batch->lastSetMs = ms;
+                if (--batch->waiting == 0) batchDone(batch);
+            }, Qt::QueuedConnection);
+        });
+    }
+}
+
+void WallpaperApplier::batchDone(const std::shared_ptr<Batch> &batch) {
+    if (batch->firstSetMs >= 0) {
+        qDebug() << "Batch applied: preloads took" << batch->preloadMs << "ms, monitors switched within"
+                 << (batch->lastSetMs - batch->firstSetMs) << "ms of each other";
+    }
+
+    for (const Batch::Entry &e : batch->entries) {
+        // header only, cheap enough on this thread for a handful of monitors
+        const qint64 keptBytes = e.keep ? qMax<qint64>(1, decodedBytes(e.filePath)) : 0;
+        onDone(e.monitor, e.filePath, e.outcome, e.error, keptBytes);
+    }
+}
+
+// -------------------------------
+// Speculative preloads
+// -------------------------------
+
+void WallpaperApplier::hovered(const QString &filePath) {
+    if (!m_speculate || filePath == m_hovered) return;
+    m_hovered = filePath;
+    if (filePath.isEmpty()) m_dwell.stop();
+    else m_dwell.start();   // restarts, only a thumbnail the mouse rests on counts
+}
+
+bool WallpaperApplier::inUse(const QString &filePath) const {
+    for (const Monitor &m : m_monitors) {
+        if (m.inFlight == filePath || m.pending == filePath) return true;
+    }
+    for (const QString &path : m_active) {
+        if (path == filePath) return true;
+    }
+    return false;
+}
+
+void WallpaperApplier::speculate() {
+    const QString filePath = m_hovered;
+    if (filePath.isEmpty() || m_speculative.contains(filePath) || inUse(filePath)) return;
+
+    Speculative &s = m_speculative[filePath];
+    s.age = ++m_age;
+    s.clock.start();
+    ++m_stats.issued;
+
+    m_pool.start([this, filePath]() {
+        QElapsedTimer clock;
+        clock.start();
+        QString error;
+        const bool ok = preloadWallpaper(filePath, error);
+        const qint64 ms = clock.elapsed();
+        const qint64 bytes = ok ? qMax<qint64>(1, decodedBytes(filePath)) : 0;
+        if (!ok) qDebug() << "Speculative preload of" << filePath << "failed:" << error;
+        QMetaObject::invokeMethod(this, [this, filePath, ok, bytes, ms]() {
+            onSpeculated(filePath, ok, bytes, ms);
+        }, Qt::QueuedConnection);
+    });
+
+    // make room for it right away, hyprpaper is decoding it as we speak
+    enforceBudget();
+}
+
+void WallpaperApplier::onSpeculated(const QString &filePath, bool ok, qint64 bytes, qint64 ms) {
+    auto it = m_speculative.find(filePath);
+    if (it == m_speculative.end()) return;
+    const QStringList waiting = it->waiting;
+
+    if (!ok) ++m_stats.failed;
+    if (!ok || !waiting.isEmpty()) {
+        m_speculative.erase(it);
+        for (const QString &monitor : waiting) {
+            // clicked away while waiting: the newer click goes next, this one stays loaded
+            const Monitor &m = m_monitors[monitor];
+            if (*m.generation != m.inFlightGeneration) onDone(monitor, filePath, Cancelled, QString(), bytes);
+            // failed ones try the normal way
+            else send(monitor, filePath, !ok);
+        }
+        return;
+    }
+
+    it->loaded = true;
+    it->bytes = bytes;
+    it->loadMs = ms;
+    enforceBudget();
+}
+
+void WallpaperApplier::keepSpeculative(const QString &filePath, qint64 bytes) {
+    if (m_speculative.contains(filePath) || inUse(filePath)) return;
+    Speculative &s = m_speculative[filePath];
+    s.loaded = true;
+    s.bytes = bytes;
+    s.age = ++m_age;
+    enforceBudget();
+}
+
+void WallpaperApplier::enforceBudget() {
+    for (;;) {
+        qint64 bytes = 0;
+        QString oldest;
+        quint64 oldestAge = 0;
+        for (auto it = m_speculative.cbegin(); it != m_speculative.cend(); ++it) {
+            bytes += it->bytes;
+            // still loading can't be unloaded yet, it gets its turn once it's in
+            if (it->loaded && it.key() != m_hovered && (oldest.isEmpty() || it->age < oldestAge)) {
+                oldest = it.key();
+                oldestAge = it->age;
+            }
+        }
+        if ((m_speculative.size() <= m_maxSpeculative && bytes <= m_maxSpeculativeBytes) || oldest.isEmpty()) return;
+
+        m_speculative.remove(oldest);
+        ++m_stats.wasted;
+        if (!inUse(oldest)) m_pool.start([oldest]() { unloadWallpaper(oldest); });
+    }
+}
+
+void WallpaperApplier::logSpeculationStats() const {
+    if (!m_speculate) return;
+    // share of the preloads nobody asked for that a click did use
+    const int clicked = m_stats.hits + m_stats.lateHits;
+    const int settled = clicked + m_stats.wasted;
+    qDebug().nospace() << "Speculative preloads: " << m_stats.issued << " issued, "
+                       << m_stats.hits << " hits, " << m_stats.lateHits << " late hits, "
+                       << m_stats.wasted << " wasted, " << m_stats.failed << " failed, hit rate "
+                       << (settled ? 100 * clicked / settled : 0) << "%, "
+                       << m_stats.savedMs << " ms saved";
+}
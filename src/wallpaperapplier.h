@@ -0,0 +1,128 @@
+// wallpaperapplier.h
+#pragma once
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <atomic>
+#include <memory>
+
+// Speculative preload counters since startup
+struct SpeculationStats {
+    int issued = 0;         // preloads started from a hover
+    int hits = 0;           // clicked once it was fully loaded, only "wallpaper" had to go out
+    int lateHits = 0;       // clicked while it was still loading
+    int wasted = 0;         // unloaded again without being clicked
+    int failed = 0;
+    qint64 savedMs = 0;     // preload time the clicks didn't have to wait for
+};
+
+// Sends wallpaper changes to hyprpaper off the GUI thread. One change per
+// monitor is on the wire at a time, clicks that come in meanwhile replace
+// each other so only the newest one is sent next. A preload that got
+// superseded before its wallpaper was set is unloaded again instead.
+//
+// With speculation on, resting the mouse on a thumbnail preloads it ahead of
+// the click. Preloads that end up unused are kept within a budget and the
+// oldest get unloaded first.
+class WallpaperApplier : public QObject {
+    Q_OBJECT
+public:
+    explicit WallpaperApplier(QObject *parent = nullptr);
+    ~WallpaperApplier();
+
+    // Speculation settings for every applier created afterwards, off by default
+    static void setSpeculation(bool enabled, int dwellMs, int maxImages, qint64 maxBytes);
+
+    void apply(const QString &monitor, const QString &filePath);
+    // Several monitors at once (monitor -> wallpaper) that switch together:
+    // each distinct wallpaper is preloaded once, all of them in parallel, and
+    // only then do the "wallpaper" commands go out, all at the same time
+    void applyBatch(const QHash<QString, QString> &assignments);
+    bool isBusy(const QString &monitor) const;
+
+    // Wallpaper under the mouse, empty once it left the grid
+    void hovered(const QString &filePath);
+
+    const SpeculationStats &speculationStats() const { return m_stats; }
+    void logSpeculationStats() const;
+
+signals:
+    void applyStarted(const QString &monitor, const QString &filePath);
+    void applied(const QString &monitor, const QString &filePath);
+    void applyFailed(const QString &monitor, const QString &filePath, const QString &error);
+    // Never sent, a newer click for the same monitor took its place
+    void applySuperseded(const QString &monitor, const QString &filePath);
+
+private:
+    struct Monitor {
+        QString inFlight;       // being sent, empty if idle
+        QString pending;        // newest click waiting for inFlight to finish
+        std::shared_ptr<std::atomic<int>> generation = std::make_shared<std::atomic<int>>(0);
+        int inFlightGeneration = 0;     // generation inFlight was started with, it's current while they match
+    };
+
+    // A preload hyprpaper holds (or is working on) that no monitor shows yet
+    struct Speculative {
+        bool loaded = false;
+        qint64 bytes = 0;       // decoded size, what it costs hyprpaper
+        qint64 loadMs = 0;
+        quint64 age = 0;        // lower = older, evicted first
+        QElapsedTimer clock;
+        QStringList waiting;    // monitors clicked on it while it was loading
+    };
+
+    enum Outcome { Applied, Failed, Cancelled };
+
+    // A batch on the wire, filled in as the replies come back
+    struct Batch {
+        struct Entry {
+            QString monitor;
+            QString filePath;
+            int generation = 0;
+            int outcome = Failed;
+            QString error;
+            bool keep = false;      // preloaded for nobody, kept as a speculative one
+        };
+        QList<Entry> entries;
+        QHash<QString, QString> preloadErrors;  // distinct wallpaper -> error, empty = loaded
+        int waiting = 0;                        // replies still to come in this phase
+        QElapsedTimer clock;
+        qint64 preloadMs = 0;
+        qint64 firstSetMs = -1;
+        qint64 lastSetMs = 0;
+    };
+
+    QThreadPool m_pool;
+    QHash<QString, Monitor> m_monitors;
+    QHash<QString, QString> m_active;   // monitor -> wallpaper hyprpaper shows
+    QHash<QString, QString> m_pendingBatch;     // waiting for its monitors to go idle
+
+    bool m_speculate = false;
+    int m_maxSpeculative = 0;
+    qint64 m_maxSpeculativeBytes = 0;
+    QTimer m_dwell;
+    QString m_hovered;
+    QHash<QString, Speculative> m_speculative;
+    quint64 m_age = 0;
+    SpeculationStats m_stats;
+
+    void start(const QString &monitor, const QString &filePath);
+    void send(const QString &monitor, const QString &filePath, bool preload);
+    void onDone(const QString &monitor, const QString &filePath, int outcome, const QString &error, qint64 keptBytes);
+
+    void startBatch(const QHash<QString, QString> &assignments);
+    void batchPreloaded(const std::shared_ptr<Batch> &batch);
+    void batchDone(const std::shared_ptr<Batch> &batch);
+    void startPendingBatch();
+
+    bool inUse(const QString &filePath) const;
+    void speculate();
+    void onSpeculated(const QString &filePath, bool ok, qint64 bytes, qint64 ms);
+    void keepSpeculative(const QString &filePath, qint64 bytes);
+    void enforceBudget();
+};
@@ -0,0 +1,180 @@
+#!/usr/bin/env python3
+"""Stand-in for Hyprland's and hyprpaper's sockets, to try the GUI's IPC
+without a running Hyprland:
+
+  tools/hypr-standin.py /tmp/hypr-standin --monitors DP-1,HDMI-A-1
+  QTHYPRPAPER_HYPR_DIR=/tmp/hypr-standin ./QtHyprpaperGUI
+
+Speaks the same one-request-per-connection protocol: read the request,
+write the reply, close. Every connection gets its own thread, so the GUI's
+concurrent requests (a batch over several monitors) overlap like they
+would against the real servers. Every request is logged with its handling
+time.
+
+.socket2.sock streams events like Hyprland's: type "add NAME" or
+"remove NAME" on stdin to hot-plug a monitor.
+"""
+
+import argparse
+import json
+import os
+import socket
+import sys
+import threading
+import time
+
+
+def hyprland_reply(req, monitors):
+    if req in ("j/monitors", "monitors"):
+        mons = [{"id": i, "name": name, "width": 1920, "height": 1080, "refreshRate": 60.0,
+                 "x": 1920 * i, "y": 0, "scale": 1.0, "focused": i == 0}
+                for i, name in enumerate(monitors)]
+        return json.dumps(mons) if req.startswith("j/") else "\n".join(monitors)
+    return "unknown request"
+
+
+class Hyprpaper:
+    def __init__(self, monitors):
+        self.monitors = monitors
+        self.loaded = set()
+        self.active = {}
+        self.lock = threading.Lock()
+
+    def reply(self, req):
+        cmd, _, arg = req.partition(" ")
+        with self.lock:
+            if cmd == "preload":
+                if not os.path.isfile(arg):
+                    return "wallpaper failed (not found)"
+                self.loaded.add(arg)
+                return "ok"
+            if cmd == "wallpaper":
+                mon, _, path = arg.partition(",")
+                path = path.strip()
+                if mon and mon not in self.monitors:
+                    return "monitor not found"
+                if path not in self.loaded:
+                    return "wallpaper not preloaded"
+                self.active[mon] = path
+                return "ok"
+            if cmd == "unload":
+                if arg == "unused" or arg == "all":
+                    keep = set(self.active.values()) if arg == "unused" else set()
+                    self.loaded &= keep
+                else:
+                    self.loaded.discard(arg)
+                return "ok"
+            if cmd == "listloaded":
+                return "\n".join(sorted(self.loaded))
+            if cmd == "listactive":
+                return "\n".join(f"{m} = {p}" for m, p in sorted(self.active.items()))
+        return "unknown request"
+
+
+class Events:
+    """Hyprland's event socket, every client gets every event until it hangs up"""
+
+    def __init__(self, monitors, paper):
+        self.monitors = monitors
+        self.paper = paper
+        self.clients = []
+        self.lock = threading.Lock()
+
+    def serve(self, path):
+        if os.path.exists(path):
+            os.unlink(path)
+        srv = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        srv.bind(path)
+        srv.listen(16)
+        while True:
+            conn, _ = srv.accept()
+            with self.lock:
+                self.clients.append(conn)
+            print(f"[events] client connected ({len(self.clients)})", flush=True)
+
+    def send(self, *lines):
+        data = "".join(line + "\n" for line in lines).encode()
+        with self.lock:
+            for conn in list(self.clients):
+                try:
+                    conn.sendall(data)
+                except OSError:
+                    self.clients.remove(conn)
+                    conn.close()
+        print(f"[events] {' | '.join(lines)} -> {len(self.clients)} clients", flush=True)
+
+    def command(self, line):
+        cmd, _, name = line.strip().partition(" ")
+        name = name.strip()
+        if cmd == "add" and name and name not in self.monitors:
+            self.monitors.append(name)
+            self.send(f"monitoradded>>{name}", f"monitoraddedv2>>{len(self.monitors) - 1},{name},stand-in {name}")
+        elif cmd == "remove" and name in self.monitors:
+            index = self.monitors.index(name)
+            self.monitors.remove(name)
+            with self.paper.lock:
+                self.paper.active.pop(name, None)
+            self.send(f"monitorremoved>>{name}", f"monitorremovedv2>>{index},{name},stand-in {name}")
+        elif line.strip():
+            print("commands: add NAME, remove NAME", flush=True)
+
+
+def handle(conn, name, handler, delay):
+    with conn:
+        start = time.perf_counter()
+        req = conn.recv(8192).decode("utf-8", "replace").strip()
+        if delay:
+            time.sleep(delay / 1000.0)
+        reply = handler(req)
+        conn.sendall(reply.encode())
+        took = (time.perf_counter() - start) * 1e6
+        print(f"[{name}] {req!r} -> {reply[:60]!r} ({took:.0f} us)", flush=True)
+
+
+def serve(path, name, handler, delay):
+    if os.path.exists(path):
+        os.unlink(path)
+    srv = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+    srv.bind(path)
+    srv.listen(16)
+    while True:
+        conn, _ = srv.accept()
+        # one slow (or --delay-ms) request doesn't hold up the next connection
+        threading.Thread(target=handle, daemon=True, args=(conn, name, handler, delay)).start()
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("dir", help="socket directory, point QTHYPRPAPER_HYPR_DIR at it")
+    ap.add_argument("--monitors", default="DP-1,HDMI-A-1", help="comma separated monitor names")
+    ap.add_argument("--delay-ms", type=float, default=0, help="added to every reply, to simulate a busy server")
+    args = ap.parse_args()
+
+    os.makedirs(args.dir, exist_ok=True)
+    monitors = [m for m in args.monitors.split(",") if m]
+    paper = Hyprpaper(monitors)
+
+    threads = [
+        threading.Thread(target=serve, daemon=True, args=(os.path.join(args.dir, ".socket.sock"), "hyprland",
+                                                          lambda r: hyprland_reply(r, monitors), args.delay_ms)),
+        threading.Thread(target=serve, daemon=True, args=(os.path.join(args.dir, ".hyprpaper.sock"), "hyprpaper",
+                                                          paper.reply, args.delay_ms)),
+    ]
+    events = Events(monitors, paper)
+    threads.append(threading.Thread(target=events.serve, daemon=True,
+                                    args=(os.path.join(args.dir, ".socket2.sock"),)))
+    for t in threads:
+        t.start()
+    print(f"Listening in {args.dir}, run the GUI with QTHYPRPAPER_HYPR_DIR={args.dir}", flush=True)
+    try:
+        for line in sys.stdin:
+            events.command(line)
+        # stdin closed (e.g. started in the background), keep serving
+        while True:
+            time.sleep(3600)
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,109 @@
+// layoutbench.cpp
+// Times full grid layout passes over your library at a few widths, like
+// resizing the window, next to the per-image walk ThumbLayout replaced.
+// Built as its own target so the old walk stays out of the app:
+//
+//   ./layoutbench [row height, default 200]
+#include <QGuiApplication>
+#include <QElapsedTimer>
+#include <QDebug>
+#include "../src/paths.h"
+#include "../src/cachedimage.h"
+#include "../src/thumbnailcacheset.h"
+#include "../src/thumbnailloader.h"
+#include "../src/thumbnailmodel.h"
+#include "../src/thumblayout.h"
+
+// The layout pass as it was before ThumbnailModel: a walk over CachedImage
+// with a QString folder compare per thumbnail. Returns the content height
+static int referenceLayout(const QList<CachedImage> &images, int width, int rowHeight,
+                           QVector<QRect> &rects, QVector<ThumbLayout::Row> &rows) {
+    rects.resize(images.size());
+    rows.clear();
+
+    int y = 0;
+    int rowWidth = 0;
+    int rowStart = 0;
+    int rowCount = 0;
+    const QString *currentFolder = nullptr;
+
+    auto placeRow = [&]() {
+        if (rowCount == 0) return;
+        int x = (width - rowWidth) / 2;
+        for (int i = rowStart; i < rowStart + rowCount; ++i) {
+            const int w = rects[i].width();
+            rects[i] = QRect(x, y, w, rowHeight);
+            x += w + SPACING;
+        }
+        rows.append({y, rowStart, rowCount});
+    };
+
+    for (int i = 0; i < images.size(); ++i) {
+        const CachedImage &cimg = images[i];
+        const QSize size = cimg.pix.isNull() ? cimg.size : cimg.pix.size();
+        const int w = size.width() <= 0 || size.height() <= 0 ? rowHeight * 16 / 9
+                                                              : size.width() * rowHeight / size.height();
+
+        if (currentFolder && *currentFolder != cimg.folder) {
+            placeRow();
+            y += rowHeight + FOLDER_GAP;
+            rowStart = i;
+            rowCount = 0;
+            rowWidth = 0;
+        }
+        currentFolder = &cimg.folder;
+
+        if (rowCount > 0 && rowWidth + w + SPACING > width) {
+            placeRow();
+            y += rowHeight + SPACING;
+            rowStart = i;
+            rowCount = 0;
+            rowWidth = 0;
+        }
+
+        rects[i] = QRect(0, 0, w, rowHeight);
+        rowWidth += w + (rowCount > 0 ? SPACING : 0);
+        ++rowCount;
+    }
+
+    if (rowCount > 0) {
+        placeRow();
+        y += rowHeight + SPACING;
+    }
+    return y;
+}
+
+int main(int argc, char *argv[]) {
+    QGuiApplication app(argc, argv);
+    const int rowHeight = argc > 1 ? qMax(1, QString(argv[1]).toInt()) : 200;
+
+    ThumbnailCacheSet cache(CACHE_FOLDER());
+    const QList<ThumbnailJob> jobs = ThumbnailLoader::scanLibrary(CACHE_FOLDER(), MAIN_FOLDER(), cache);
+    const QList<CachedImage> images = ThumbnailLoader::placeholders(jobs);
+    ThumbnailModel model;
+    model.assign(images);
+
+    const int passes = 500;
+    ThumbLayout layout;
+    QElapsedTimer t;
+    t.start();
+    for (int i = 0; i < passes; ++i) layout.ensure(model, 800 + (i % 8) * 60, rowHeight);
+    const double modelUs = t.nsecsElapsed() / passes / 1000.0;
+
+    // the old walk over the same library and widths, ends on the same width
+    QVector<QRect> rects;
+    QVector<ThumbLayout::Row> rows;
+    int height = 0;
+    t.restart();
+    for (int i = 0; i < passes; ++i) height = referenceLayout(images, 800 + (i % 8) * 60, rowHeight, rects, rows);
+    const double referenceUs = t.nsecsElapsed() / passes / 1000.0;
+
+    qInfo() << "Layout of" << model.size() << "thumbnails:" << modelUs << "us per pass,"
+            << layout.rows().size() << "rows";
+    qInfo() << "Reference CachedImage walk:" << referenceUs << "us per pass," << rows.size() << "rows,"
+            << (modelUs > 0 ? referenceUs / modelUs : 0.0) << "x slower";
+    // widths can round one pixel differently (float aspect vs integer division)
+    if (rows.size() != layout.rows().size() || height != layout.contentHeight())
+        qInfo() << "Layouts differ:" << layout.contentHeight() << "vs" << height << "px tall";
+    return 0;
+}